@@ -32,12 +32,11 @@ void MainWindow::addNode(QTreeWidgetItem* parent, FwJSON::Node* node)
             parent->setText(1, "object");
 
                 FwJSON::Object* object = FwJSON::cast<FwJSON::Object>(node);
-                QHash<QByteArray, FwJSON::Node*> attributes = object->attributes();
-                for(QHash<QByteArray, FwJSON::Node*>::const_iterator iter = attributes.begin(); iter != attributes.end(); ++iter)
+                for(const FwJSON::Attribute& attribute : *object)
                 {
                     QTreeWidgetItem* childItem = new QTreeWidgetItem(parent);
-                    childItem->setText(0, QString::fromUtf8(iter.key()));
-                    addNode(childItem, iter.value());
+                    childItem->setText(0, QString::fromUtf8(attribute.name));
+                    addNode(childItem, attribute.value);
                 }
 
                 QString str = "<empty>";
@@ -73,7 +72,7 @@ void MainWindow::addNode(QTreeWidgetItem* parent, FwJSON::Node* node)
             parent->setText(1, QString("array[%1]").arg(array->size()));
 
             int i = 0;
-            foreach(FwJSON::Node* child, array->toQVector())
+            for(FwJSON::Node* child : *array)
             {
                 QTreeWidgetItem* childItem = new QTreeWidgetItem(parent);
                 childItem->setText(0, QString("[%1]").arg(i++));
@@ -87,6 +86,11 @@ void MainWindow::addNode(QTreeWidgetItem* parent, FwJSON::Node* node)
             parent->setText(2, QString::fromUtf8(node->toUtf8()));
         }
         break;
+    case FwJSON::Type::Null:
+        {
+            parent->setText(1, "null");
+        }
+        break;
     default:
         break;
 
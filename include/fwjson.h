@@ -1,8 +1,12 @@
 #pragma once
 
+#include <atomic>
+
+#include <QtCore/qbitarray.h>
 #include <QtCore/qhash.h>
 #include <QtCore/qvector.h>
 #include <QtCore/qmetatype.h>
+#include <QtCore/qscopedpointer.h>
 
 #include "fwjson_global.h"
 #include "fwjsonexception.h"
@@ -18,6 +22,14 @@ namespace FwJSON
     class Array;
     class Object;
     class Array;
+    struct Attribute;
+    struct Column;
+    struct Statistics;
+    struct Histogram;
+    class Key;
+    class Path;
+    class Reader;
+    class Writer;
 
     enum class Type
     {
@@ -29,19 +41,201 @@ namespace FwJSON
         Array
     };
 
+    enum ParseOption
+    {
+        NoParseOptions = 0x0,
+        DecodeEscapes = 0x1,     //Unescape string values once while parsing
+        PackNumericArrays = 0x2, //Store arrays of numbers packed, see FwJSON::Array::pack()
+        ColumnarArrays = 0x4     //Store arrays of uniform objects by columns, see FwJSON::Array::toColumnar()
+    };
+    Q_DECLARE_FLAGS(ParseOptions, ParseOption)
+
     template <Type type_id> class Base;
     template <typename T, Type type_id> class BaseValue;
 
     const char constantTrue[] = "true";
     const char constantFalse[] = "false";
+    const char constantNull[] = "null";
 
     FWJSON_SHARED_EXPORT bool nameToBool(const QByteArray&, bool* bOk);
     FWJSON_SHARED_EXPORT QByteArray boolToName(bool value);
 
+    //Appends the UTF-8 text with JSON escape sequences decoded to out,
+    //returns false if one of the sequences is malformed
+    FWJSON_SHARED_EXPORT bool unescapeUtf8(const char* utf8, int size, QByteArray* out);
+
+    //Replaces out with the text in JSON string form, returns false if
+    //nothing had to be escaped
+    FWJSON_SHARED_EXPORT bool escapeUtf8(const QString& string, QByteArray* out);
+
+    inline uint hashName(const char* name, int size);
+    Q_DECL_CONSTEXPR inline uint hashName(const char* name, int size, uint hash);
+
     template <class T>
     T* cast(Node* node);
+
+    template <class T>
+    const T* cast(const Node* node);
 }
 
+Q_DECLARE_OPERATORS_FOR_FLAGS(FwJSON::ParseOptions)
+
+////////////////////////////////////////////////////////////////////////////////
+
+struct FwJSON::Attribute
+{
+    QByteArray name;
+    FwJSON::Node* value;
+    uint hash;
+};
+
+Q_DECLARE_TYPEINFO(FwJSON::Attribute, Q_MOVABLE_TYPE);
+
+//Values of one attribute of a columnar array, indexed by the row
+struct FwJSON::Column
+{
+    QByteArray name;
+    FwJSON::Type type;
+
+    //Rows which have the attribute
+    QBitArray present;
+
+    //Values of a Number column
+    QVector<double> numbers;
+
+    //Values of a String column, equal strings share the data
+    QVector<QString> strings;
+
+    //Values of a Boolean column or rows of a String column which
+    //hold escape sequences
+    QBitArray flags;
+};
+
+Q_DECLARE_TYPEINFO(FwJSON::Column, Q_MOVABLE_TYPE);
+
+//Aggregates of numeric values, min and max are 0 if there are no values
+struct FwJSON::Statistics
+{
+    Statistics() : count(0), sum(0.), min(0.), max(0.) {}
+
+    inline double mean() const
+    {
+        return count > 0 ? sum / count : 0.;
+    }
+
+    inline void add(double value)
+    {
+        min = (count == 0 || value < min) ? value : min;
+        max = (count == 0 || value > max) ? value : max;
+        sum += value;
+        count++;
+    }
+
+    inline void add(const FwJSON::Statistics& other)
+    {
+        if(other.count > 0)
+        {
+            min = (count == 0 || other.min < min) ? other.min : min;
+            max = (count == 0 || other.max > max) ? other.max : max;
+            sum += other.sum;
+            count += other.count;
+        }
+    }
+
+    int count;
+    double sum;
+    double min;
+    double max;
+};
+
+//Counts of values in equal bins of [min, max], values out of the range
+//and NaN are skipped
+struct FwJSON::Histogram
+{
+    Histogram(double min, double max, int size) :
+        min(min),
+        max(max),
+        scale(max > min ? size / (max - min) : 0.),
+        bins(qMax(size, 0), 0)
+    {
+    }
+
+    inline void add(double value)
+    {
+        if(value >= min && value <= max && !bins.isEmpty())
+        {
+            int bin = static_cast<int>((value - min) * scale);
+            bins[qMin(bin, bins.size() - 1)]++;
+        }
+    }
+
+    //Adds counts of a histogram with the same range and size
+    inline void add(const QVector<int>& counts)
+    {
+        for(int i = 0; i < counts.size() && i < bins.size(); i++)
+        {
+            bins[i] += counts.at(i);
+        }
+    }
+
+    double min;
+    double max;
+    double scale;
+    QVector<int> bins;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+/*
+   Attribute name with the hash computed at compile time:
+
+       static constexpr FwJSON::Key idKey("id");
+       object->value<FwJSON::Number>(idKey);
+
+   The key also remembers the position where it was found last time,
+   so objects with the same attributes order are looked up without
+   probing. The name is not copied and must outlive the key.
+*/
+class FwJSON::Key
+{
+public:
+    friend class FwJSON::Object;
+
+    template <int N>
+    Q_DECL_CONSTEXPR Key(const char (&name)[N])
+        : m_name(name),
+          m_size(N - 1),
+          m_hash(FwJSON::hashName(name, N - 1, 2166136261u)),
+          m_slot(-1)
+    {}
+
+    Q_DECL_CONSTEXPR Key(const char* name, int size)
+        : m_name(name),
+          m_size(size),
+          m_hash(FwJSON::hashName(name, size, 2166136261u)),
+          m_slot(-1)
+    {}
+
+    Key(const Key& other)
+        : m_name(other.m_name),
+          m_size(other.m_size),
+          m_hash(other.m_hash),
+          m_slot(other.m_slot.load(std::memory_order_relaxed))
+    {}
+
+    Q_DECL_CONSTEXPR inline const char* name() const { return m_name; }
+    Q_DECL_CONSTEXPR inline int size() const { return m_size; }
+    Q_DECL_CONSTEXPR inline uint hash() const { return m_hash; }
+
+private:
+    Key& operator=(const Key&);
+
+    const char* m_name;
+    int m_size;
+    uint m_hash;
+    mutable std::atomic<int> m_slot;
+};
+
 ////////////////////////////////////////////////////////////////////////////////
 
 class FWJSON_SHARED_EXPORT FwJSON::Node
@@ -54,6 +248,18 @@ public:
     Node();
     virtual ~Node();
 
+    /*
+       Memory of deleted nodes is kept in free lists of the thread which
+       deleted them, one list per node size, and given to new nodes of
+       that thread. So parsing of similar documents in a loop reuses the
+       nodes of the previous ones instead of allocating them.
+    */
+    static void* operator new(size_t size);
+    static void operator delete(void* pointer, size_t size);
+
+    //Frees the nodes memory kept by the current thread
+    static void releaseFreeNodes();
+
     virtual Type type() const = 0;
     inline bool isNull() const;
 
@@ -61,10 +267,28 @@ public:
 
     virtual QByteArray toUtf8() const = 0;
 
+    /*
+       Appends the same output as toUtf8() to the writer, nested values
+       are written directly without temporary buffers. Cached forms of
+       objects and arrays are used, but they are stored only if the
+       writer has no device.
+    */
+    void write(FwJSON::Writer* writer) const;
+
     inline FwJSON::Node* parent() const;
 
     void takeFromParent();
 
+    /*
+       Structural hash and comparison of the subtree, the attributes
+       order does not matter. The hash is computed once and reset when
+       the subtree is changed. Computing it hashes every nested node, so
+       a change resets the hashes of its ancestors up to the first one
+       with nothing cached, see invalidate().
+    */
+    uint hash() const;
+    bool equals(const FwJSON::Node* other) const;
+
     virtual int toInt(bool* bOk) const = 0;
     virtual uint toUint(bool* bOk) const = 0;
     virtual bool toBool(bool* bOk) const = 0;
@@ -73,8 +297,75 @@ public:
 
     virtual FwJSON::Node* clone() const = 0;
 
+    /*
+       Makes the subtree read-only: packed and columnar arrays are
+       unpacked, String values are converted from UTF-8 and hashes are
+       computed. After that the const methods do not change anything
+       and a frozen tree can be read by any number of threads without
+       locking, clone() makes an unfrozen copy which shares the frozen
+       nodes until it changes them, see FwJSON::Object::clone(). Prefer begin()/end()
+       and String::value() there, attributes() and toList() build new
+       containers on every call. Changing a frozen tree is not allowed.
+    */
+    void freeze();
+    inline bool isFrozen() const;
+
+protected:
+    //Resets cached state of the node and its ancestors
+    void invalidate();
+
 private:
+    uint structuralHash() const;
+
+    //Place of the serialized form of an object or array in the buffer
+    //of the writer
+    struct Utf8Range
+    {
+        const FwJSON::Node* node;
+        int offset;
+        int size;
+    };
+
+    //Writes the cached form of the node if there is such, the forms of
+    //objects and arrays are added to cached if it is not null
+    static void writeUtf8(const FwJSON::Node* node, FwJSON::Writer* writer, QVector<Utf8Range>* cached);
+
+    //Cached form of an object or array, false if there is none
+    static bool cachedUtf8(const FwJSON::Node* node, const char** data, int* size);
+
+    //Empty arrays and arrays of them serialize to nothing
+    static bool isEmptyUtf8(const FwJSON::Node* node);
+    static void clearUtf8Cache(const FwJSON::Node* node);
+
+    //Makes the target equal to the source of the same type, see
+    //FwJSON::Object::reparse()
+    static void update(FwJSON::Node* target, FwJSON::Node* source, QVector<FwJSON::Node*>* changed);
+
+    //Makes the target equal to the next value of the reader, returns
+    //false without reading if the value has another type
+    static bool update(FwJSON::Reader* reader, FwJSON::Node* target, FwJSON::ParseOptions options,
+                       QVector<FwJSON::Node*>* changed);
+
+    //Builds the next value of the reader the way the parser does
+    static FwJSON::Node* readNode(FwJSON::Reader* reader, FwJSON::ParseOptions options);
+
+    //True if the reader accepts the document, it checks the escape
+    //sequences too, so update() does not fail on such documents
+    static bool isStrict(const QByteArray& utf8String);
+
     FwJSON::Node* parent_ = nullptr;
+    mutable uint hash_ = 0;
+    mutable bool hashed_ = false;
+    bool frozen_ = false;
+
+    //Result of isEmptyUtf8(), reset when the subtree is changed
+    mutable bool emptyChecked_ = false;
+    mutable bool empty_ = false;
+
+    //Buffer shared by the cached forms of the objects and arrays which
+    //were serialized together, null if the form is not cached. Object
+    //and Array keep the range of their own form in it
+    mutable QByteArray utf8_;
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -115,6 +406,7 @@ public:
     inline void setValue(const BaseType& value)
     {
         m_value = value;
+        this->invalidate();
     }
 
 private:
@@ -124,11 +416,14 @@ private:
 ////////////////////////////////////////////////////////////////////////////////
 
 class FWJSON_SHARED_EXPORT FwJSON::String
-    : public FwJSON::BaseValue<QString, FwJSON::Type::String>
+    : public FwJSON::Base<FwJSON::Type::String>
 {
-    using BaseClass = FwJSON::BaseValue<QString, FwJSON::Type::String>;
+    using BaseClass = FwJSON::Base<FwJSON::Type::String>;
 
 public:
+    friend class FwJSON::Node;
+
+    typedef QString BaseType;
 
     inline static BaseType defaultValue()
     {
@@ -137,8 +432,29 @@ public:
 
     explicit String(const QString& value = defaultValue());
 
+    /*
+       Creates string which references [offset, offset + size) bytes of
+       the UTF-8 source without copying them. The QString value is
+       decoded on the first access. The escaped flag tells that the
+       bytes contain escape sequences.
+    */
+    String(const QByteArray& source, int offset, int size, bool escaped);
+
+    /*
+       Creates string which references the escaped source bytes for
+       serialization and holds their already unescaped value.
+    */
+    String(const QByteArray& source, int offset, int size, const QString& value);
+
     inline bool isEmpty() const;
 
+    const QString& value() const;
+    void setValue(const QString& value);
+
+    inline bool hasEscapes() const;
+
+    QByteArray utf8() const;
+
     QByteArray toUtf8() const;
 
     virtual int toInt(bool* bOk) const;
@@ -148,6 +464,16 @@ public:
     virtual QString toString(bool* bOk) const;
 
     FwJSON::Node* clone() const;
+
+private:
+    bool hasSameText(const FwJSON::String* other) const;
+
+    QByteArray m_source;
+    int m_offset;
+    int m_size;
+    bool m_escaped;
+    mutable bool m_decoded;
+    mutable QString m_value;
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -205,6 +531,27 @@ public:
 
 ////////////////////////////////////////////////////////////////////////////////
 
+class FWJSON_SHARED_EXPORT FwJSON::Null
+    : public FwJSON::Base<FwJSON::Type::Null>
+{
+    using BaseClass = FwJSON::Base<FwJSON::Type::Null>;
+
+public:
+    Null();
+
+    QByteArray toUtf8() const;
+
+    virtual int toInt(bool* bOk) const;
+    virtual uint toUint(bool* bOk) const;
+    virtual bool toBool(bool* bOk) const;
+    virtual double toNumber(bool* bOk) const;
+    virtual QString toString(bool* bOk) const;
+
+    FwJSON::Node* clone() const;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
 class FWJSON_SHARED_EXPORT FwJSON::Object
     : public FwJSON::Base<FwJSON::Type::Object>
 {
@@ -212,6 +559,10 @@ class FWJSON_SHARED_EXPORT FwJSON::Object
 public:
 
     friend class FwJSON::Node;
+    friend class FwJSON::Parser;
+    friend class FwJSON::Path;
+
+    typedef const FwJSON::Attribute* const_iterator;
 
     Object();
     ~Object();
@@ -222,28 +573,92 @@ public:
     inline String* addString(const QByteArray& name, const QString& value);
     inline Number* addNumber(const QByteArray& name, double value);
     inline Boolean* addBoolean(const QByteArray& name, bool value);
+    inline Null* addNull(const QByteArray& name);
     inline Object* addObject(const QByteArray& name);
     inline Array* addArray(const QByteArray& name);
 
     void clear();
 
+    //Exchanges attributes with the other object without copying them
+    void swap(FwJSON::Object& other);
+
     inline FwJSON::Node* attribute(const QByteArray& name) const;
+    inline FwJSON::Node* attribute(const char* name) const;
+    inline FwJSON::Node* attribute(QLatin1String name) const;
+    inline FwJSON::Node* attribute(const char* name, int size) const;
+    inline FwJSON::Node* attribute(const FwJSON::Key& key) const;
+
+    //Non-const access gives a copy of a frozen object its own children
+    //first, see clone()
+    inline FwJSON::Node* attribute(const QByteArray& name);
+    inline FwJSON::Node* attribute(const char* name);
+    inline FwJSON::Node* attribute(QLatin1String name);
+    inline FwJSON::Node* attribute(const char* name, int size);
+    inline FwJSON::Node* attribute(const FwJSON::Key& key);
+
     inline QByteArray attributeName(FwJSON::Node* child) const;
 
-    template<class T> bool hasValue(const QByteArray& name, typename T::BaseType* value = 0);
+    template<class T> bool hasValue(const QByteArray& name, typename T::BaseType* value = 0) const;
+    template<class T> bool hasValue(const char* name, typename T::BaseType* value = 0) const;
+    template<class T> bool hasValue(QLatin1String name, typename T::BaseType* value = 0) const;
+    template<class T> bool hasValue(const FwJSON::Key& key, typename T::BaseType* value = 0) const;
+
+    template<class T> typename T::BaseType value(const QByteArray& name, const typename T::BaseType& defaultValue = T::defaultValue()) const;
+    template<class T> typename T::BaseType value(const char* name, const typename T::BaseType& defaultValue = T::defaultValue()) const;
+    template<class T> typename T::BaseType value(QLatin1String name, const typename T::BaseType& defaultValue = T::defaultValue()) const;
+    template<class T> typename T::BaseType value(const FwJSON::Key& key, const typename T::BaseType& defaultValue = T::defaultValue()) const;
 
-    template<class T> typename T::BaseType value(const QByteArray& name, const typename T::BaseType& defaultValue = T::defaultValue());
     template<class T> T* setValue(const QByteArray& name, const typename T::BaseType& value);
+    template<class T> T* setValue(const char* name, const typename T::BaseType& value);
+    template<class T> T* setValue(QLatin1String name, const typename T::BaseType& value);
+    template<class T> T* setValue(const FwJSON::Key& key, const typename T::BaseType& value);
 
     inline QHash<QByteArray, FwJSON::Node*> attributes() const;
+    inline QHash<QByteArray, FwJSON::Node*> attributes();
     inline QList<FwJSON::Node*> toList() const;
+    inline QList<FwJSON::Node*> toList();
     inline int attributesCount() const;
 
+    //Attributes in the insertion order, usable in range-based for
+    inline const_iterator begin() const;
+    inline const_iterator end() const;
+    inline const_iterator begin();
+    inline const_iterator end();
+
     QByteArray toUtf8() const;
 
-    void parse(const QByteArray& utf8String);
-    void parse(QIODevice* ioDevice);
-    void parseFile(const QString& fileName);
+    /*
+       Keeps serialized forms of the object and of all nested objects
+       and arrays. A change resets the cached forms of the changed node
+       and of its ancestors, so toUtf8() serializes only the changed
+       branches again and copies the rest from the cache. Disabling
+       frees the cached forms.
+    */
+    void setUtf8Cached(bool cached);
+    inline bool isUtf8Cached() const;
+
+    void parse(const QByteArray& utf8String, FwJSON::ParseOptions options = FwJSON::NoParseOptions);
+    void parse(QIODevice* ioDevice, FwJSON::ParseOptions options = FwJSON::NoParseOptions);
+    void parseFile(const QString& fileName, FwJSON::ParseOptions options = FwJSON::NoParseOptions);
+
+    /*
+       Makes the object equal to the parsed document by walking the tree
+       alongside it and changing only the differing nodes: scalar values
+       and packed numbers are assigned in place, nodes of other types are
+       replaced, missing attributes and items are removed and new ones
+       are added at the end. Strings reference the document instead of
+       being copied, so a document of the same shape is applied without
+       allocating nodes. Unchanged nodes keep their addresses and cached
+       hashes. Columnar arrays are read again and replaced if they
+       differ, documents which only the lenient parser accepts are parsed
+       into a temporary tree and merged. A malformed document throws and
+       leaves the object unchanged. The changed list receives assigned
+       and added nodes, containers which lost children and packed
+       arrays with changed numbers.
+    */
+    void reparse(const QByteArray& utf8String,
+                 FwJSON::ParseOptions options = FwJSON::NoParseOptions,
+                 QVector<FwJSON::Node*>* changed = nullptr);
 
     virtual int toInt(bool* bOk) const;
     virtual uint toUint(bool* bOk) const;
@@ -251,10 +666,69 @@ public:
     virtual double toNumber(bool* bOk) const;
     virtual QString toString(bool* bOk) const;
 
+    /*
+       Applies JSON Merge Patch (RFC 7386): null attributes of the patch
+       remove attributes, object attributes are merged recursively and
+       other ones replace attributes with the same name. The values are
+       cloned, the rvalue overload moves them out of the patch instead
+       and leaves it empty.
+    */
+    void mergePatch(const FwJSON::Object& patch);
+    void mergePatch(FwJSON::Object&& patch);
+
+    /*
+       Deep copy of the object. The copy of a frozen object is made in
+       constant time instead: it shares the children and reads them
+       with the const methods, the first non-const access to them
+       (attribute(), begin(), addAttribute() and so on) replaces them
+       with their copies, which share the next level in turn. So
+       changing a few values of a large frozen template copies only the
+       objects and arrays on the way to them. The shared nodes report
+       the frozen parent, and the frozen tree has to outlive the copy.
+    */
     FwJSON::Node* clone() const;
 
 private:
-    QHash<QByteArray, FwJSON::Node*> m_attributes;
+    //Gives a copy of a frozen object its own children, see clone()
+    inline void detach();
+    void copySharedChildren();
+
+    template<class T> inline bool findValue(const char* name, int size, typename T::BaseType* value) const;
+    template<class T> T* setValue(const char* name, int size, const typename T::BaseType& value);
+
+    int indexOf(const char* name, int size, uint hash) const;
+    inline int indexOf(const FwJSON::Key& key) const;
+    int indexOf(const FwJSON::Node* value) const;
+    //Appends the attribute, the caller invalidates the object
+    void insertAttribute(const QByteArray& name, uint hash, FwJSON::Node* value);
+
+    //addAttribute() with the hash of the name known, the parser takes it
+    //from the previous record
+    FwJSON::Node* addAttribute(const QByteArray& name, uint hash, FwJSON::Node* value, bool replace);
+
+    //addAttribute() for an object under construction, it has nothing
+    //cached, so nothing is invalidated
+    FwJSON::Node* addParsedAttribute(const QByteArray& name, uint hash, FwJSON::Node* value);
+    void mergeAttribute(const FwJSON::Attribute& attribute, FwJSON::Object* source);
+    void removeAttributeAt(int index);
+    void insertIndex(int index);
+    void updateIndex();
+    void serialize(FwJSON::Writer* writer, QVector<Utf8Range>* cached) const;
+
+    mutable QVector<FwJSON::Attribute> m_attributes;
+
+    //Open addressing table of m_attributes indexes, it is built
+    //only for objects with many attributes
+    mutable QVector<int> m_index;
+
+    //The children belong to the frozen object this one was cloned from
+    bool m_shared;
+
+    bool m_utf8Cached;
+
+    //Cached form in utf8_
+    mutable int m_utf8Offset;
+    mutable int m_utf8Size;
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -266,17 +740,27 @@ class FWJSON_SHARED_EXPORT FwJSON::Array : public FwJSON::Base<FwJSON::Type::Arr
 public:
 
     friend class FwJSON::Node;
+    friend class FwJSON::Parser;
+
+    typedef FwJSON::Node* const* const_iterator;
 
     Array();
     ~Array();
 
     void clear();
 
+    //Exchanges items with the other array without copying them
+    void swap(FwJSON::Array& other);
+
     Node* addValue(FwJSON::Node* node);
+    Node* insertValue(int index, FwJSON::Node* node);
 
     inline String* addString(const QString& value);
     inline Number* addNumber(double value);
+    //Does not create a node while the array holds packed numbers only
+    void appendNumber(double value);
     inline Boolean* addBoolean(bool value);
+    inline Null* addNull();
     inline Object* addObject();
     inline Array* addArray();
 
@@ -285,20 +769,112 @@ public:
     inline int indexOf(FwJSON::Node* item) const;
     inline FwJSON::Node* item(int index) const;
 
+    //See FwJSON::Object::attribute()
+    inline FwJSON::Node* item(int index);
+
+    /*
+       Item to read which does not unpack the array: a Number or an
+       Object standing for the item of a packed or columnar array is
+       built in the temporary and lives until the temporary is used
+       again. equals(), diff(), FwJSON::Schema and the aggregations of
+       FwJSON::Path read arrays this way.
+    */
+    const FwJSON::Node* itemView(int index, QScopedPointer<FwJSON::Node>* temporary) const;
+
+    //Items usable in range-based for
+    inline const_iterator begin() const;
+    inline const_iterator end() const;
+    inline const_iterator begin();
+    inline const_iterator end();
+
     QByteArray toUtf8() const;
 
+    //See FwJSON::Object::setUtf8Cached()
+    void setUtf8Cached(bool cached);
+    inline bool isUtf8Cached() const;
+
     virtual int toInt(bool* bOk) const;
     virtual uint toUint(bool* bOk) const;
     virtual bool toBool(bool* bOk) const;
     virtual double toNumber(bool* bOk) const;
     virtual QString toString(bool* bOk) const;
 
+    //Packed numbers and columns of the copy are implicitly shared
+    //until one of the arrays changes, the items of a frozen array are
+    //shared until the first non-const access, see FwJSON::Object::clone()
     FwJSON::Node* clone() const;
 
     inline QVector<FwJSON::Node*> toQVector() const;
+    inline QVector<FwJSON::Node*> toQVector();
+
+    /*
+       Replaces Number items with a contiguous buffer of their values,
+       returns false if the array is empty or holds other types. Number
+       nodes are created again by the first call which needs them:
+       item(), begin(), addValue() and so on.
+    */
+    bool pack();
+    inline bool isPacked() const;
+
+    //Values of a packed array, empty if the array is not packed
+    inline const QVector<double>& numbers() const;
+
+    /*
+       Stores an array of objects with String, Number and Boolean
+       attributes as one column per attribute name, returns false if
+       the array holds other values. Like with pack() the objects are
+       created again on the first access to them, their attributes
+       follow the columns order.
+    */
+    bool toColumnar();
+    inline bool isColumnar() const;
+
+    //Column of a columnar array, nullptr if there is no such attribute
+    const FwJSON::Column* column(const QByteArray& name) const;
+
+    /*
+       Aggregates of Number items or of Number attributes with the name
+       of Object items, other values are skipped. Packed and columnar
+       arrays are aggregated without creating nodes.
+    */
+    FwJSON::Statistics statistics() const;
+    FwJSON::Statistics statistics(const QByteArray& name) const;
+
+    //Counts of values in equal bins of [min, max], values out of the
+    //range are skipped
+    QVector<int> histogram(double min, double max, int bins) const;
+    QVector<int> histogram(const QByteArray& name, double min, double max, int bins) const;
 
 private:
-    QVector<FwJSON::Node*> m_data;
+    inline void unpack() const;
+    void materialize() const;
+
+    //See FwJSON::Object::detach()
+    inline void detach();
+    void copySharedChildren();
+
+    //addValue() and appendNumber() for an array under construction,
+    //see FwJSON::Object::addParsedAttribute()
+    FwJSON::Node* addParsedValue(FwJSON::Node* node);
+    void appendParsedNumber(double value);
+
+    //Object standing for a row of the columnar array
+    FwJSON::Object* row(int index) const;
+    void serialize(FwJSON::Writer* writer, QVector<Utf8Range>* cached) const;
+
+    mutable QVector<FwJSON::Node*> m_data;
+    mutable QVector<double> m_numbers;
+    mutable bool m_packed;
+    mutable QVector<FwJSON::Column> m_columns;
+
+    //See FwJSON::Object
+    bool m_shared;
+
+    bool m_utf8Cached;
+
+    //See FwJSON::Object
+    mutable int m_utf8Offset;
+    mutable int m_utf8Size;
 };
 
 #include "fwjson_inl.h"
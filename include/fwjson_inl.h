@@ -8,36 +8,156 @@ T* FwJSON::cast(Node* node)
     return node && node->type() == T::typeID ? static_cast<T*>(node) : nullptr;
 }
 
+template <class T>
+const T* FwJSON::cast(const Node* node)
+{
+    return node && node->type() == T::typeID ? static_cast<const T*>(node) : nullptr;
+}
+
+uint FwJSON::hashName(const char* name, int size)
+{
+    //32-bit FNV-1a
+    uint hash = 2166136261u;
+    for(int i = 0; i < size; i++)
+    {
+        hash = (hash ^ static_cast<quint8>(name[i])) * 16777619u;
+    }
+    return hash;
+}
+
+Q_DECL_CONSTEXPR uint FwJSON::hashName(const char* name, int size, uint hash)
+{
+    return size > 0 ? hashName(name + 1, size - 1, (hash ^ static_cast<quint8>(*name)) * 16777619u) : hash;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 
+bool FwJSON::Node::isNull() const
+{
+    return type() == FwJSON::Type::Null;
+}
+
 FwJSON::Node* FwJSON::Node::parent() const
 {
     return parent_;
 }
 
+bool FwJSON::Node::isFrozen() const
+{
+    return frozen_;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 
 bool FwJSON::String::isEmpty() const
 {
-    return value().isEmpty();
+    return m_source.isNull() ? m_value.isEmpty() : m_size == 0;
+}
+
+bool FwJSON::String::hasEscapes() const
+{
+    return m_escaped;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 
 FwJSON::Node* FwJSON::Object::attribute(const QByteArray& name) const
 {
-    return m_attributes.value(name, 0);
+    return attribute(name.constData(), name.size());
+}
+
+FwJSON::Node* FwJSON::Object::attribute(const char* name) const
+{
+    return attribute(name, qstrlen(name));
+}
+
+FwJSON::Node* FwJSON::Object::attribute(QLatin1String name) const
+{
+    return attribute(name.latin1(), name.size());
+}
+
+FwJSON::Node* FwJSON::Object::attribute(const char* name, int size) const
+{
+    int index = indexOf(name, size, hashName(name, size));
+    return index < 0 ? nullptr : m_attributes.at(index).value;
+}
+
+FwJSON::Node* FwJSON::Object::attribute(const FwJSON::Key& key) const
+{
+    int index = indexOf(key);
+    return index < 0 ? nullptr : m_attributes.at(index).value;
+}
+
+FwJSON::Node* FwJSON::Object::attribute(const QByteArray& name)
+{
+    detach();
+    return static_cast<const FwJSON::Object*>(this)->attribute(name);
+}
+
+FwJSON::Node* FwJSON::Object::attribute(const char* name)
+{
+    detach();
+    return static_cast<const FwJSON::Object*>(this)->attribute(name);
+}
+
+FwJSON::Node* FwJSON::Object::attribute(QLatin1String name)
+{
+    detach();
+    return static_cast<const FwJSON::Object*>(this)->attribute(name);
+}
+
+FwJSON::Node* FwJSON::Object::attribute(const char* name, int size)
+{
+    detach();
+    return static_cast<const FwJSON::Object*>(this)->attribute(name, size);
+}
+
+FwJSON::Node* FwJSON::Object::attribute(const FwJSON::Key& key)
+{
+    detach();
+    return static_cast<const FwJSON::Object*>(this)->attribute(key);
+}
+
+void FwJSON::Object::detach()
+{
+    //Frozen copies keep sharing, nothing may change them
+    if(m_shared && !frozen_)
+    {
+        copySharedChildren();
+    }
+}
+
+int FwJSON::Object::indexOf(const FwJSON::Key& key) const
+{
+    int slot = key.m_slot.load(std::memory_order_relaxed);
+    if(slot >= 0 && slot < m_attributes.size())
+    {
+        const FwJSON::Attribute& attribute = m_attributes.at(slot);
+        if(attribute.hash == key.m_hash && attribute.name.size() == key.m_size &&
+           memcmp(attribute.name.constData(), key.m_name, key.m_size) == 0)
+        {
+            return slot;
+        }
+    }
+
+    int index = indexOf(key.m_name, key.m_size, key.m_hash);
+    if(index >= 0)
+    {
+        key.m_slot.store(index, std::memory_order_relaxed);
+    }
+    return index;
 }
 
 QByteArray FwJSON::Object::attributeName(FwJSON::Node* child) const
 {
-    return m_attributes.key(child, "");
+    int index = indexOf(child);
+    return index < 0 ? QByteArray("") : m_attributes.at(index).name;
 }
 
 template<class T>
-bool FwJSON::Object::hasValue(const QByteArray& name, typename T::BaseType* value)
+bool FwJSON::Object::findValue(const char* name, int size, typename T::BaseType* value) const
 {
-    if (T* node = cast<T>(attribute(name)))
+    if (const T* node = cast<T>(attribute(name, size)))
     {
         if (value)
         {
@@ -49,15 +169,87 @@ bool FwJSON::Object::hasValue(const QByteArray& name, typename T::BaseType* valu
 }
 
 template<class T>
-typename T::BaseType FwJSON::Object::value(const QByteArray& name, const typename T::BaseType& defaultValue)
+bool FwJSON::Object::hasValue(const QByteArray& name, typename T::BaseType* value) const
+{
+    return findValue<T>(name.constData(), name.size(), value);
+}
+
+template<class T>
+bool FwJSON::Object::hasValue(const char* name, typename T::BaseType* value) const
+{
+    return findValue<T>(name, qstrlen(name), value);
+}
+
+template<class T>
+bool FwJSON::Object::hasValue(QLatin1String name, typename T::BaseType* value) const
+{
+    return findValue<T>(name.latin1(), name.size(), value);
+}
+
+template<class T>
+bool FwJSON::Object::hasValue(const FwJSON::Key& key, typename T::BaseType* value) const
+{
+    if (const T* node = cast<T>(attribute(key)))
+    {
+        if (value)
+        {
+            (*value) = node->value();
+        }
+        return true;
+    }
+    return false;
+}
+
+template<class T>
+typename T::BaseType FwJSON::Object::value(const QByteArray& name, const typename T::BaseType& defaultValue) const
+{
+    if (const T* node = cast<T>(attribute(name.constData(), name.size())))
+    {
+        return node->value();
+    }
+    return defaultValue;
+}
+
+template<class T>
+typename T::BaseType FwJSON::Object::value(const char* name, const typename T::BaseType& defaultValue) const
+{
+    if (const T* node = cast<T>(attribute(name, qstrlen(name))))
+    {
+        return node->value();
+    }
+    return defaultValue;
+}
+
+template<class T>
+typename T::BaseType FwJSON::Object::value(QLatin1String name, const typename T::BaseType& defaultValue) const
 {
-    if (T* node = cast<T>(attribute(name)))
+    if (const T* node = cast<T>(attribute(name.latin1(), name.size())))
     {
         return node->value();
     }
     return defaultValue;
 }
 
+template<class T>
+typename T::BaseType FwJSON::Object::value(const FwJSON::Key& key, const typename T::BaseType& defaultValue) const
+{
+    if (const T* node = cast<T>(attribute(key)))
+    {
+        return node->value();
+    }
+    return defaultValue;
+}
+
+template<class T> T* FwJSON::Object::setValue(const char* name, int size, const typename T::BaseType& value)
+{
+    if(T* node = cast<T>(attribute(name, size)))
+    {
+        node->setValue(value);
+        return node;
+    }
+    return static_cast<T*>(addAttribute(QByteArray(name, size), new T(value), true));
+}
+
 template<class T> T* FwJSON::Object::setValue(const QByteArray& name, const typename T::BaseType& value)
 {
     if(T* node = cast<T>(attribute(name)))
@@ -68,21 +260,70 @@ template<class T> T* FwJSON::Object::setValue(const QByteArray& name, const type
     return static_cast<T*>(addAttribute(name, new T(value), true));
 }
 
+template<class T> T* FwJSON::Object::setValue(const char* name, const typename T::BaseType& value)
+{
+    return setValue<T>(name, qstrlen(name), value);
+}
+
+template<class T> T* FwJSON::Object::setValue(QLatin1String name, const typename T::BaseType& value)
+{
+    return setValue<T>(name.latin1(), name.size(), value);
+}
+
+template<class T> T* FwJSON::Object::setValue(const FwJSON::Key& key, const typename T::BaseType& value)
+{
+    if(T* node = cast<T>(attribute(key)))
+    {
+        node->setValue(value);
+        return node;
+    }
+    return static_cast<T*>(addAttribute(QByteArray(key.name(), key.size()), new T(value), true));
+}
+
 QHash<QByteArray, FwJSON::Node*> FwJSON::Object::attributes() const
 {
-    return m_attributes;
+    QHash<QByteArray, FwJSON::Node*> attributes;
+    attributes.reserve(m_attributes.size());
+    foreach(const FwJSON::Attribute& attribute, m_attributes)
+    {
+        attributes.insert(attribute.name, attribute.value);
+    }
+    return attributes;
+}
+
+QHash<QByteArray, FwJSON::Node*> FwJSON::Object::attributes()
+{
+    detach();
+    return static_cast<const FwJSON::Object*>(this)->attributes();
 }
 
 QList<FwJSON::Node*> FwJSON::Object::toList() const
 {
-    return m_attributes.values();
+    QList<FwJSON::Node*> values;
+    values.reserve(m_attributes.size());
+    foreach(const FwJSON::Attribute& attribute, m_attributes)
+    {
+        values.append(attribute.value);
+    }
+    return values;
+}
+
+QList<FwJSON::Node*> FwJSON::Object::toList()
+{
+    detach();
+    return static_cast<const FwJSON::Object*>(this)->toList();
 }
 
 void FwJSON::Object::removeAttribute(const QByteArray& name)
 {
-    if(m_attributes.contains(name))
+    detach();
+    int index = indexOf(name.constData(), name.size(), hashName(name.constData(), name.size()));
+    if(index >= 0)
     {
-        delete m_attributes.take(name);
+        FwJSON::Node* node = m_attributes.at(index).value;
+        removeAttributeAt(index);
+        node->parent_ = nullptr;
+        delete node;
     }
 }
 
@@ -91,6 +332,33 @@ int FwJSON::Object::attributesCount() const
     return m_attributes.size();
 }
 
+bool FwJSON::Object::isUtf8Cached() const
+{
+    return m_utf8Cached;
+}
+
+FwJSON::Object::const_iterator FwJSON::Object::begin() const
+{
+    return m_attributes.constData();
+}
+
+FwJSON::Object::const_iterator FwJSON::Object::end() const
+{
+    return m_attributes.constData() + m_attributes.size();
+}
+
+FwJSON::Object::const_iterator FwJSON::Object::begin()
+{
+    detach();
+    return m_attributes.constData();
+}
+
+FwJSON::Object::const_iterator FwJSON::Object::end()
+{
+    detach();
+    return m_attributes.constData() + m_attributes.size();
+}
+
 FwJSON::String* FwJSON::Object::addString(const QByteArray& name, const QString& value)
 {
     return static_cast<String*>(addAttribute(name, new String(value)));
@@ -106,6 +374,11 @@ FwJSON::Boolean* FwJSON::Object::addBoolean(const QByteArray& name, bool value)
     return static_cast<Boolean*>(addAttribute(name, new Boolean(value)));
 }
 
+FwJSON::Null* FwJSON::Object::addNull(const QByteArray& name)
+{
+    return static_cast<Null*>(addAttribute(name, new Null()));
+}
+
 FwJSON::Object* FwJSON::Object::addObject(const QByteArray& name)
 {
     return static_cast<Object*>(addAttribute(name, new Object()));
@@ -118,8 +391,24 @@ FwJSON::Array* FwJSON::Object::addArray(const QByteArray& name)
 
 ///////////////////////////////////////////////////////////////////////////////
 
+void FwJSON::Array::unpack() const
+{
+    if(m_packed || !m_columns.isEmpty())
+    {
+        materialize();
+    }
+}
+
 int FwJSON::Array::size() const
 {
+    if(m_packed)
+    {
+        return m_numbers.size();
+    }
+    if(!m_columns.isEmpty())
+    {
+        return m_columns.first().present.size();
+    }
     return m_data.size();
 }
 
@@ -130,6 +419,7 @@ int FwJSON::Array::indexOf(FwJSON::Node* item) const
 
 FwJSON::Node* FwJSON::Array::item(int index) const
 {
+    unpack();
     if(index < m_data.size() && index >= 0)
     {
         return m_data.at(index);
@@ -137,11 +427,77 @@ FwJSON::Node* FwJSON::Array::item(int index) const
     return 0;
 }
 
+FwJSON::Node* FwJSON::Array::item(int index)
+{
+    detach();
+    return static_cast<const FwJSON::Array*>(this)->item(index);
+}
+
 QVector<FwJSON::Node*> FwJSON::Array::toQVector() const
 {
+    unpack();
     return m_data;
 }
 
+QVector<FwJSON::Node*> FwJSON::Array::toQVector()
+{
+    detach();
+    return static_cast<const FwJSON::Array*>(this)->toQVector();
+}
+
+void FwJSON::Array::detach()
+{
+    //See FwJSON::Object::detach()
+    if(m_shared && !frozen_)
+    {
+        copySharedChildren();
+    }
+}
+
+FwJSON::Array::const_iterator FwJSON::Array::begin() const
+{
+    unpack();
+    return m_data.constData();
+}
+
+FwJSON::Array::const_iterator FwJSON::Array::end() const
+{
+    unpack();
+    return m_data.constData() + m_data.size();
+}
+
+FwJSON::Array::const_iterator FwJSON::Array::begin()
+{
+    detach();
+    return static_cast<const FwJSON::Array*>(this)->begin();
+}
+
+FwJSON::Array::const_iterator FwJSON::Array::end()
+{
+    detach();
+    return static_cast<const FwJSON::Array*>(this)->end();
+}
+
+bool FwJSON::Array::isPacked() const
+{
+    return m_packed;
+}
+
+bool FwJSON::Array::isUtf8Cached() const
+{
+    return m_utf8Cached;
+}
+
+const QVector<double>& FwJSON::Array::numbers() const
+{
+    return m_numbers;
+}
+
+bool FwJSON::Array::isColumnar() const
+{
+    return !m_columns.isEmpty();
+}
+
 FwJSON::String* FwJSON::Array::addString(const QString& value)
 {
     return static_cast<String*>(addValue(new String(value)));
@@ -157,6 +513,11 @@ FwJSON::Boolean* FwJSON::Array::addBoolean(bool value)
     return static_cast<Boolean*>(addValue(new Boolean(value)));
 }
 
+FwJSON::Null* FwJSON::Array::addNull()
+{
+    return static_cast<Null*>(addValue(new Null()));
+}
+
 FwJSON::Object* FwJSON::Array::addObject()
 {
     return static_cast<Object*>(addValue(new Object()));
@@ -0,0 +1,286 @@
+#pragma once
+
+#include <QtCore/qstring.h>
+
+#include "fwjson.h"
+#include "fwjsonwriter.h"
+
+namespace FwJSON
+{
+    class Reader;
+    class Schema;
+    template <class T> struct Field;
+    template <class T> struct Binding;
+
+    /*
+       Parses the document straight into a struct described by
+       FWJSON_BINDING, no nodes are created:
+
+           struct Sample
+           {
+               double ts;
+               QString id;
+               QVector<int> values;
+           };
+
+           FWJSON_BINDING(Sample, FWJSON_FIELD(ts), FWJSON_FIELD(id), FWJSON_FIELD(values))
+
+           Sample sample;
+           FwJSON::read(utf8String, &sample);
+
+       Fields may be bool, int, uint, qint64, double, QString, QByteArray
+       (unescaped UTF-8), QVector of them and other bound structs.
+       Attributes without a field and null values are skipped, fields
+       missing in the document keep their values. Integer fields take
+       integral numbers only, 1.0 and 1e3 included. The document has to
+       be strict JSON, forms which only the lenient parser takes, like
+       01 or 1., are malformed. Throws FwJSON::Exception if the document
+       is malformed or a value does not fit its field.
+    */
+    template <class T> void read(const QByteArray& utf8String, T* object);
+
+    //Serializes the bound struct without creating nodes, attribute names
+    //are written with quotes and colons prepared at compile time
+    template <class T> void write(const T& object, FwJSON::Writer* writer);
+    template <class T> QByteArray write(const T& object);
+}
+
+//Describes one member, see FWJSON_FIELD
+template <class T>
+struct FwJSON::Field
+{
+    const char* name;
+    int size;
+    uint hash;
+    const char* key; //"name":
+    int keySize;
+    void (*read)(FwJSON::Reader* reader, T* object);
+    void (*write)(FwJSON::Writer* writer, const T* object);
+};
+
+//Recursive descent reader of the bound types
+class FWJSON_SHARED_EXPORT FwJSON::Reader
+{
+public:
+    friend class FwJSON::Node;
+    friend class FwJSON::Schema;
+
+    explicit Reader(const QByteArray& utf8String);
+
+    void read(bool* value);
+    void read(int* value);
+    void read(uint* value);
+    void read(qint64* value);
+    void read(double* value);
+    void read(QString* value);
+    void read(QByteArray* value);
+    template <class T> void read(QVector<T>* values);
+    template <class T> void read(T* object);
+
+    //Throws if anything but spaces follows the value
+    void finish();
+
+    //Skips null and returns true if the next value is null
+    bool readNull();
+
+    //Skips the next value of any type
+    void skipValue();
+
+    //Type of the next value, throws at the end of the document
+    FwJSON::Type peek();
+
+    /*
+       Iterate over the object or array, the name is valid until the next
+       call. The value of each attribute or item must be read or skipped
+       before the next call.
+    */
+    void beginObject();
+    bool nextAttribute(const char** name, int* size);
+    void beginArray();
+    bool nextItem();
+
+private:
+    Reader(const Reader&);
+    Reader& operator=(const Reader&);
+
+    template <class T> static const FwJSON::Field<T>* findField(const FwJSON::Field<T>* fields, int count, int next,
+                                                                const char* name, int size);
+
+    inline void skipSpaces();
+    void expect(char c);
+    void fail(const QByteArray& error) const;
+    void stringRange(int* begin, int* end, bool* escaped);
+    double number();
+
+    //Number which has to be an integer in the range, the type names it
+    //in errors
+    qint64 integer(qint64 minimum, qint64 maximum, const char* type);
+
+    //Like nextAttribute() but gives the range of the name with escapes
+    bool nextAttributeRange(int* begin, int* end, bool* escaped);
+
+    QByteArray m_source;
+    const char* m_begin;
+    const char* m_end;
+    const char* m_current;
+    int m_depth;
+    QByteArray m_name;
+};
+
+template <class T>
+void FwJSON::Reader::read(QVector<T>* values)
+{
+    if(readNull())
+    {
+        return;
+    }
+
+    values->clear();
+    beginArray();
+    while(nextItem())
+    {
+        values->append(T());
+        read(&values->last());
+    }
+}
+
+template <class T>
+const FwJSON::Field<T>* FwJSON::Reader::findField(const FwJSON::Field<T>* fields, int count, int next,
+                                                  const char* name, int size)
+{
+    //Attributes usually follow the fields order, so the next field is
+    //compared first and the hash is computed only if it differs
+    if(next < count && fields[next].size == size && memcmp(fields[next].name, name, size) == 0)
+    {
+        return fields + next;
+    }
+
+    uint hash = FwJSON::hashName(name, size);
+    for(int i = 0; i < count; i++)
+    {
+        if(fields[i].hash == hash && fields[i].size == size && memcmp(fields[i].name, name, size) == 0)
+        {
+            return fields + i;
+        }
+    }
+    return nullptr;
+}
+
+template <class T>
+void FwJSON::Reader::read(T* object)
+{
+    if(readNull())
+    {
+        return;
+    }
+
+    int count = 0;
+    const FwJSON::Field<T>* fields = FwJSON::Binding<T>::fields(&count);
+    int next = 0;
+
+    const char* name = nullptr;
+    int size = 0;
+    beginObject();
+    while(nextAttribute(&name, &size))
+    {
+        if(const FwJSON::Field<T>* field = findField(fields, count, next, name, size))
+        {
+            field->read(this, object);
+            next = static_cast<int>(field - fields) + 1;
+        }
+        else
+        {
+            skipValue();
+        }
+    }
+}
+
+template <class T>
+typename std::enable_if<FwJSON::IsBound<T>::value>::type FwJSON::Writer::write(const T& object)
+{
+    int count = 0;
+    const FwJSON::Field<T>* fields = FwJSON::Binding<T>::fields(&count);
+
+    writeRaw('{');
+    for(int i = 0; i < count; i++)
+    {
+        if(i > 0)
+        {
+            writeRaw(',');
+        }
+        writeRaw(fields[i].key, fields[i].keySize);
+        fields[i].write(this, &object);
+    }
+    writeRaw('}');
+}
+
+namespace FwJSON
+{
+    template <class T, class M, M T::*member>
+    void readField(FwJSON::Reader* reader, T* object)
+    {
+        reader->read(&(object->*member));
+    }
+
+    template <class T, class M, M T::*member>
+    void writeField(FwJSON::Writer* writer, const T* object)
+    {
+        writer->write(object->*member);
+    }
+
+    template <class T>
+    void read(const QByteArray& utf8String, T* object)
+    {
+        FwJSON::Reader reader(utf8String);
+        reader.read(object);
+        reader.finish();
+    }
+
+    template <class T>
+    void write(const T& object, FwJSON::Writer* writer)
+    {
+        writer->write(object);
+    }
+
+    template <class T>
+    QByteArray write(const T& object)
+    {
+        QByteArray utf8;
+        FwJSON::Writer writer(&utf8);
+        writer.write(object);
+        return utf8;
+    }
+}
+
+//Must be used in the global namespace
+#define FWJSON_BINDING(Type, ...) \
+    namespace FwJSON \
+    { \
+        template <> \
+        struct Binding<Type> \
+        { \
+            typedef Type Struct; \
+            static const FwJSON::Field<Type>* fields(int* count) \
+            { \
+                static const FwJSON::Field<Type> list[] = { __VA_ARGS__ }; \
+                (*count) = static_cast<int>(sizeof(list) / sizeof(list[0])); \
+                return list; \
+            } \
+        }; \
+        template <> \
+        struct IsBound<Type> \
+        { \
+            static const bool value = true; \
+        }; \
+    }
+
+//Attribute with the name of the member, the hash and the quoted key are
+//computed at compile time
+#define FWJSON_FIELD(member) \
+    { #member, \
+      static_cast<int>(sizeof(#member) - 1), \
+      FwJSON::hashName(#member, static_cast<int>(sizeof(#member) - 1), 2166136261u), \
+      "\"" #member "\":", \
+      static_cast<int>(sizeof(#member) + 2), \
+      &FwJSON::readField<Struct, decltype(Struct::member), &Struct::member>, \
+      &FwJSON::writeField<Struct, decltype(Struct::member), &Struct::member> }
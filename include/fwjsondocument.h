@@ -0,0 +1,87 @@
+#pragma once
+
+#include <QtCore/qmutex.h>
+
+#include "fwjson.h"
+
+namespace FwJSON
+{
+    class SharedDocument;
+}
+
+/*
+   Holds the current version of a document for many reader threads and
+   replaces it without stopping them:
+
+       FwJSON::SharedDocument config(root);
+
+       //Reader thread
+       FwJSON::SharedDocument::Reader reader(config);
+       const FwJSON::Object* object = FwJSON::cast<FwJSON::Object>(reader.root());
+
+       //Writer thread
+       config.publish(newRoot);
+
+   Published trees are frozen, see FwJSON::Node::freeze(). Readers do not
+   lock anything: they are counted in the current epoch and the writer
+   deletes the replaced tree after all readers of the previous epoch
+   are destroyed. So readers should be short living, publish() waits
+   for them. Copies of the root made by clone() share its nodes and have
+   to be destroyed before the reader as well.
+*/
+class FWJSON_SHARED_EXPORT FwJSON::SharedDocument
+{
+public:
+    class Reader;
+
+    //Takes ownership of the root
+    explicit SharedDocument(FwJSON::Node* root = nullptr);
+    ~SharedDocument();
+
+    //Replaces the root and deletes the previous one when no reader
+    //uses it, publishers are serialized
+    void publish(FwJSON::Node* root);
+
+private:
+    SharedDocument(const SharedDocument&);
+    SharedDocument& operator=(const SharedDocument&);
+
+    int enter() const;
+    inline void leave(int epoch) const;
+
+    std::atomic<FwJSON::Node*> m_root;
+    mutable std::atomic<int> m_epoch;
+    mutable std::atomic<int> m_readers[2];
+    QMutex m_publishMutex;
+};
+
+//Keeps the root which was current on construction alive
+class FwJSON::SharedDocument::Reader
+{
+public:
+    explicit Reader(const FwJSON::SharedDocument& document)
+        : m_document(document),
+          m_epoch(document.enter()),
+          m_root(document.m_root.load(std::memory_order_acquire))
+    {}
+
+    ~Reader()
+    {
+        m_document.leave(m_epoch);
+    }
+
+    inline const FwJSON::Node* root() const { return m_root; }
+
+private:
+    Reader(const Reader&);
+    Reader& operator=(const Reader&);
+
+    const FwJSON::SharedDocument& m_document;
+    int m_epoch;
+    const FwJSON::Node* m_root;
+};
+
+void FwJSON::SharedDocument::leave(int epoch) const
+{
+    m_readers[epoch].fetch_sub(1, std::memory_order_release);
+}
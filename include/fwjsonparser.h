@@ -2,8 +2,95 @@
 
 #include "fwjson.h"
 
+class QIODevice;
+
+/*
+   Parsing engine which keeps its state between documents: scratch
+   buffers and attribute names seen before are reused, so one parser
+   per thread parses a stream of messages without warming up again.
+   FwJSON::Object::parse() creates a temporary parser. A parser is not
+   thread-safe, nodes are recycled per thread, see FwJSON::Node.
+*/
 class FWJSON_SHARED_EXPORT FwJSON::Parser
 {
 public:
-    Parser();
+    explicit Parser(FwJSON::ParseOptions options = FwJSON::NoParseOptions);
+    ~Parser();
+
+    inline FwJSON::ParseOptions options() const;
+    inline void setOptions(FwJSON::ParseOptions options);
+
+    //Nesting of objects and arrays including the root, 0 is no limit
+    inline int maxDepth() const;
+    inline void setMaxDepth(int depth);
+
+    //Size of the input in bytes, 0 is no limit
+    inline int maxSize() const;
+    inline void setMaxSize(int size);
+
+    /*
+       Count of attribute names kept to be shared with later documents
+       instead of copied, 0 disables it. The kept names stay until
+       clearNames() is called.
+    */
+    inline int namesLimit() const;
+    inline void setNamesLimit(int limit);
+    void clearNames();
+
+    //Adds attributes of the document to the object, on error the object
+    //is cleared and FwJSON::Exception is thrown
+    void parse(const QByteArray& utf8String, FwJSON::Object* object);
+    void parse(QIODevice* ioDevice, FwJSON::Object* object);
+
+private:
+    struct Data;
+
+    Parser(const Parser&);
+    Parser& operator=(const Parser&);
+
+    FwJSON::ParseOptions m_options;
+    int m_maxDepth;
+    int m_maxSize;
+    int m_namesLimit;
+    Data* m_data;
 };
+
+FwJSON::ParseOptions FwJSON::Parser::options() const
+{
+    return m_options;
+}
+
+void FwJSON::Parser::setOptions(FwJSON::ParseOptions options)
+{
+    m_options = options;
+}
+
+int FwJSON::Parser::maxDepth() const
+{
+    return m_maxDepth;
+}
+
+void FwJSON::Parser::setMaxDepth(int depth)
+{
+    m_maxDepth = depth;
+}
+
+int FwJSON::Parser::maxSize() const
+{
+    return m_maxSize;
+}
+
+void FwJSON::Parser::setMaxSize(int size)
+{
+    m_maxSize = size;
+}
+
+int FwJSON::Parser::namesLimit() const
+{
+    return m_namesLimit;
+}
+
+void FwJSON::Parser::setNamesLimit(int limit)
+{
+    m_namesLimit = limit;
+}
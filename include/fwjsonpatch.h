@@ -0,0 +1,22 @@
+#pragma once
+
+#include "fwjson.h"
+
+namespace FwJSON
+{
+    /*
+       Returns JSON Patch (RFC 6902) which turns source into target, the
+       caller owns the returned array. Subtrees are compared by their
+       cached hashes first, see FwJSON::Node::hash(), so identical
+       branches are skipped. Arrays are compared item by item after
+       skipping their common head and tail.
+    */
+    FWJSON_SHARED_EXPORT FwJSON::Array* diff(const FwJSON::Node* source, const FwJSON::Node* target);
+
+    /*
+       Applies JSON Patch to the tree in place, values of the patch are
+       cloned. Throws FwJSON::Exception if an operation fails, operations
+       before the failed one stay applied.
+    */
+    FWJSON_SHARED_EXPORT void applyPatch(FwJSON::Node* root, const FwJSON::Array& patch);
+}
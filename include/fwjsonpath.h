@@ -0,0 +1,112 @@
+#pragma once
+
+#include "fwjson.h"
+
+/*
+   JSON Pointer (RFC 6901) compiled once into steps and evaluated many
+   times:
+
+       FwJSON::Path path("/devices/0:2/name");
+       path.visit(root, [](FwJSON::Node* node) { ...; return true; });
+
+   Besides the pointer syntax the path supports two kinds of tokens:
+   "*" matches all attributes of an object or all items of an array,
+   "start:end" matches the array items in [start, end), negative bounds
+   count from the end of the array and both bounds are optional. Applied
+   to an object a slice token is an ordinary attribute name.
+
+   The evaluation allocates nothing, results are passed to the visitor
+   in the document order. Visiting items of packed and columnar arrays
+   unpacks them, count(), statistics() and histogram() read such items
+   through temporary nodes instead, see FwJSON::Array::itemView().
+*/
+class FWJSON_SHARED_EXPORT FwJSON::Path
+{
+public:
+    //Throws FwJSON::Exception if the pointer is malformed
+    explicit Path(const QByteArray& pointer = QByteArray());
+
+    //Unescaped reference tokens of the pointer, throws FwJSON::Exception
+    //if the pointer is malformed
+    static QList<QByteArray> split(const QByteArray& pointer);
+
+    //Array index of the reference token: "0" or digits without a leading
+    //zero, -1 if the token is not an index
+    static int arrayIndex(const QByteArray& token);
+
+    inline const QByteArray& pointer() const;
+
+    //True if the path can match at most one node
+    inline bool isSingle() const;
+
+    //First matching node or nullptr
+    FwJSON::Node* first(FwJSON::Node* root) const;
+
+    //Appends matching nodes to the list, returns count of them
+    int evaluate(FwJSON::Node* root, QVector<FwJSON::Node*>* nodes) const;
+
+    int count(FwJSON::Node* root) const;
+
+    //Aggregates of matching Number nodes and of Number items of matching
+    //arrays, see FwJSON::Array::statistics()
+    FwJSON::Statistics statistics(FwJSON::Node* root) const;
+    QVector<int> histogram(FwJSON::Node* root, double min, double max, int bins) const;
+
+    //Calls bool visitor(FwJSON::Node*) for every matching node until
+    //the visitor returns false, returns false if it was stopped
+    template<class Visitor> bool visit(FwJSON::Node* root, Visitor visitor) const;
+
+private:
+    typedef bool(*Callback)(FwJSON::Node* node, void* context);
+
+    struct Step
+    {
+        enum Kind
+        {
+            Name,
+            Wildcard,
+            Slice
+        };
+
+        Kind kind;
+        QByteArray name;
+        uint hash;
+
+        //Array index of a Name step (-1 if the name is not an index)
+        //or the first index of a Slice
+        int index;
+        int end;
+    };
+
+    template<class Visitor> static bool invoke(FwJSON::Node* node, void* context);
+
+    //Arrays are not unpacked if view is true, see FwJSON::Array::itemView()
+    bool evaluate(FwJSON::Node* node, int step, Callback callback, void* context, bool view) const;
+    static FwJSON::Node* item(FwJSON::Array* array, int index, QScopedPointer<FwJSON::Node>* temporary, bool view);
+
+    QByteArray m_pointer;
+    QVector<Step> m_steps;
+    bool m_single;
+};
+
+const QByteArray& FwJSON::Path::pointer() const
+{
+    return m_pointer;
+}
+
+bool FwJSON::Path::isSingle() const
+{
+    return m_single;
+}
+
+template<class Visitor>
+bool FwJSON::Path::invoke(FwJSON::Node* node, void* context)
+{
+    return (*static_cast<Visitor*>(context))(node);
+}
+
+template<class Visitor>
+bool FwJSON::Path::visit(FwJSON::Node* root, Visitor visitor) const
+{
+    return evaluate(root, 0, &FwJSON::Path::invoke<Visitor>, &visitor, false);
+}
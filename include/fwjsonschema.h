@@ -0,0 +1,99 @@
+#pragma once
+
+#include <QtCore/qregularexpression.h>
+
+#include "fwjson.h"
+
+namespace FwJSON
+{
+    class Reader;
+    class Schema;
+}
+
+/*
+   JSON Schema compiled once into a table of rules and checked many
+   times, either against a tree or against the source text while it is
+   tokenized, so invalid documents are rejected before nodes are built:
+
+       FwJSON::Schema schema(schemaObject);
+       schema.validate(utf8String);
+       object.parse(utf8String);
+
+   The supported keywords are type, properties, required, items (one
+   schema for all items), enum of scalars, minimum, maximum, minLength,
+   maxLength, minItems, maxItems and pattern. Other keywords are
+   ignored. Lengths are counted in UTF-16 code units.
+*/
+class FWJSON_SHARED_EXPORT FwJSON::Schema
+{
+public:
+    //Throws FwJSON::Exception if the schema uses a keyword wrongly
+    explicit Schema(const FwJSON::Object& schema);
+
+    /*
+       Throw FwJSON::Exception with the JSON Pointer of the first invalid
+       value. Malformed text is rejected too, the text overload adds the
+       line and column of the error.
+    */
+    void validate(const FwJSON::Node* node) const;
+    void validate(const QByteArray& utf8String) const;
+
+    bool isValid(const FwJSON::Node* node) const;
+    bool isValid(const QByteArray& utf8String) const;
+
+private:
+    struct Value
+    {
+        FwJSON::Type type;
+        double number;
+        QString string;
+    };
+
+    struct Property
+    {
+        QByteArray name;
+        uint hash;
+        int rule; //-1 if the property is only required
+        bool required;
+    };
+
+    struct Rule
+    {
+        int types; //Bits of FwJSON::Type, 0 allows any type
+        bool integer;
+        double minimum;
+        double maximum;
+        int minLength;
+        int maxLength;
+        int minItems;
+        int maxItems;
+        QRegularExpression pattern;
+        QVector<FwJSON::Schema::Value> values;
+        QVector<FwJSON::Schema::Property> properties;
+        int required;
+        int items; //-1 if items are not checked
+    };
+
+    //Position of the checked value, the pointer is built only on error
+    struct Frame
+    {
+        const Frame* parent;
+        const char* name;
+        int size;
+        int index;
+    };
+
+    int compile(const FwJSON::Object& schema);
+    static int property(const FwJSON::Schema::Rule& rule, const char* name, int size, int next);
+
+    void check(int rule, const FwJSON::Node* node, const Frame* frame) const;
+    void check(int rule, FwJSON::Reader* reader, const Frame* frame) const;
+    static QByteArray checkType(const FwJSON::Schema::Rule& rule, FwJSON::Type type);
+
+    //Checks a scalar value, booleans are passed as numbers 0 and 1
+    static QByteArray checkValue(const FwJSON::Schema::Rule& rule, FwJSON::Type type,
+                                 double number, const QString& string);
+    static QByteArray violation(const Frame* frame, const QByteArray& error);
+
+    QVector<Rule> m_rules;
+};
@@ -0,0 +1,180 @@
+#pragma once
+
+#include <type_traits>
+
+#include <QtCore/qbytearray.h>
+#include <QtCore/qstring.h>
+#include <QtCore/qvector.h>
+
+#include "fwjson_global.h"
+
+class QIODevice;
+
+namespace FwJSON
+{
+    class Node;
+    class Writer;
+
+    //Set by FWJSON_BINDING for the structs it describes
+    template <class T> struct IsBound { static const bool value = false; };
+}
+
+/*
+   Appends JSON values to the end of the buffer or writes them to the
+   device. Strings are escaped, the caller writes punctuation and
+   attribute names with writeRaw(). Trees are written by
+   FwJSON::Node::write(), bound structs by FwJSON::write(), see
+   fwjsonbinding.h.
+*/
+class FWJSON_SHARED_EXPORT FwJSON::Writer
+{
+public:
+    explicit Writer(QByteArray* buffer);
+
+    /*
+       Collects the output in a buffer and writes it to the device each
+       time the buffer grows to the block size. The destructor writes
+       the rest ignoring errors, flush() throws FwJSON::Exception if the
+       device fails.
+    */
+    explicit Writer(QIODevice* device, int blockSize = 64 * 1024);
+    ~Writer();
+
+    void flush();
+
+    //The target buffer or the one not written to the device yet
+    inline QByteArray* buffer() const;
+    inline QIODevice* device() const;
+
+    //Count of bytes written by the writer
+    inline qint64 size() const;
+
+    inline void writeRaw(char c);
+    inline void writeRaw(const char* data, int size);
+
+    void write(bool value);
+    void write(int value);
+    void write(uint value);
+    void write(qint64 value);
+    void write(double value); //Fewest digits which read back, null if not finite
+    void write(const QString& value);
+    void write(const QByteArray& value); //UTF-8 text
+    void writeNull();
+    template <class T> void write(const QVector<T>& values);
+    template <class T> typename std::enable_if<FwJSON::IsBound<T>::value>::type write(const T& object);
+
+    /*
+       Streaming interface which writes separators itself:
+
+           FwJSON::Writer writer(&file);
+           writer.beginArray();
+           foreach(const Record& record, records)
+           {
+               writer.beginObject();
+               writer.key("id");
+               writer.value(record.id);
+               writer.endObject();
+           }
+           writer.endArray();
+           writer.flush();
+
+       Values are the types accepted by write(), including bound structs.
+       Debug builds assert that every attribute has a key, that begin and
+       end calls match and that there is one root value.
+    */
+    void beginObject();
+    void endObject();
+    void beginArray();
+    void endArray();
+    void key(const char* name);
+    void key(const QByteArray& name);
+    template <class T> inline void value(const T& value);
+    void value(const char* value);
+    void nullValue();
+
+    //Writes the tree like Node::write(), nested empty arrays are skipped
+    //with their separators but a tree which serializes to nothing is
+    //written as [] so the value is not lost
+    void nodeValue(const FwJSON::Node* node);
+
+private:
+    Writer(const Writer&);
+    Writer& operator=(const Writer&);
+
+    void writeInteger(quint64 value, bool negative);
+    void writeEscaped(const char* data, int size);
+
+    //Writes the separator before a value of the streaming interface
+    void separate();
+
+    QByteArray* m_buffer;
+    QByteArray m_block;
+    QIODevice* m_device;
+    int m_blockSize;
+
+    //Added to the buffer size to get the count of written bytes
+    qint64 m_offset;
+
+    //No value was streamed into the current object or array yet and
+    //a written key waits for its value
+    bool m_first;
+    bool m_afterKey;
+
+    //Open objects and arrays, tracked by debug builds only
+    QByteArray m_nesting;
+};
+
+QByteArray* FwJSON::Writer::buffer() const
+{
+    return m_buffer;
+}
+
+QIODevice* FwJSON::Writer::device() const
+{
+    return m_device;
+}
+
+qint64 FwJSON::Writer::size() const
+{
+    return m_offset + m_buffer->size();
+}
+
+void FwJSON::Writer::writeRaw(char c)
+{
+    m_buffer->append(c);
+    if(m_device && m_buffer->size() >= m_blockSize)
+    {
+        flush();
+    }
+}
+
+void FwJSON::Writer::writeRaw(const char* data, int size)
+{
+    m_buffer->append(data, size);
+    if(m_device && m_buffer->size() >= m_blockSize)
+    {
+        flush();
+    }
+}
+
+template <class T>
+void FwJSON::Writer::value(const T& value)
+{
+    separate();
+    write(value);
+}
+
+template <class T>
+void FwJSON::Writer::write(const QVector<T>& values)
+{
+    writeRaw('[');
+    for(int i = 0; i < values.size(); i++)
+    {
+        if(i > 0)
+        {
+            writeRaw(',');
+        }
+        write(values.at(i));
+    }
+    writeRaw(']');
+}
@@ -1,9 +1,16 @@
-#include <QtCore/QBuffer>
 #include <QtCore/QIODevice>
 #include <QtCore/QDebug>
 #include <QtCore/QDir>
+#include <QtCore/QSet>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 #include "fwjson.h"
+#include "fwjsonbinding.h"
+#include "fwjsonparser.h"
+#include "fwjsonwriter.h"
 
 //Parse utils
 namespace
@@ -21,6 +28,7 @@ namespace
         C_Sig,     //Char '+' and '-'
 
         C_Sp,      //Space (' ')
+        C_Ws,      //Tab, line feed and carriage return, not allowed in strings
 
         C_Str,     //Quotation mark (")
         C_Bsl,     //Backslash (\)
@@ -44,7 +52,7 @@ namespace
 
           /*0 */ /*1 */ /*2 */ /*3 */ /*4 */ /*5 */ /*6 */ /*7 */
 /*  0 */  C_Err, C_Err, C_Err, C_Err, C_Err, C_Err, C_Err, C_Err,
-/*  8 */  C_Err, C_Sp,  C_Err, C_Err, C_Err, C_Err, C_Err, C_Err,
+/*  8 */  C_Err, C_Ws,  C_Ws,  C_Err, C_Err, C_Ws,  C_Err, C_Err,
 /* 16 */  C_Err, C_Err, C_Err, C_Err, C_Err, C_Err, C_Err, C_Err,
 /* 24 */  C_Err, C_Err, C_Err, C_Err, C_Err, C_Err, C_Err, C_Err,
 
@@ -116,34 +124,281 @@ namespace
 
     //Parse command or parse state
     const CommandFunc parse_commands[X_MAX][C_MAX] = {
-/*            C_AZ,   C_Ee,  C_Uni,  C_Num,  C_Fra, C_Sig,    C_Sp,  C_Str,  C_Bsl,  C_Col,            C_LCu,  C_RCu,  C_LSq,  C_RSq,  C_Sep,  C_Err */
-/*X_DOC*/{  &x_var, &x_var, &x_err, &x_err, &x_err, &x_err, &x_ign, &x_bst, &x_err, &x_err, /*X_DOC*/ &x_doc, &x_err, &x_err, &x_err, &x_err, &x_err  },
-/*X_VAR*/{       0,      0, &x_err,      0, &x_err, &x_err, &x_est, &x_err, &x_err, &x_atr, /*X_VAR*/ &x_ob2, &x_eob, &x_ar2, &x_ear, &x_val, &x_err  },
-/*X_STR*/{       0,      0,      0,      0,      0,      0,      0, &x_est, &x_bsc,      0, /*X_STR*/      0,      0,      0,      0,      0, &x_err  },
-/*X_SCH*/{  &x_esc, &x_err, &x_err, &x_err, &x_err, &x_err, &x_err, &x_esc, &x_esc, &x_err, /*X_STR*/ &x_err, &x_err, &x_err, &x_err, &x_err, &x_err  },
-/*X_VAL*/{  &x_var, &x_var, &x_err, &x_int, &x_err, &x_sg1, &x_ign, &x_bst, &x_err, &x_err, /*X_VAL*/ &x_ob1, &x_err, &x_ar1, &x_ear, &x_val, &x_err  },
-/*X_INT*/{  &x_err, &x_re2, &x_err,      0, &x_re1, &x_err, &x_enu, &x_err, &x_err, &x_err, /*X_INT*/ &x_err, &x_eob, &x_err, &x_ear, &x_val, &x_err  },
-/*X_RE1*/{  &x_err, &x_re2, &x_err,      0, &x_err, &x_err, &x_enu, &x_err, &x_err, &x_err, /*X_RE1*/ &x_err, &x_eob, &x_err, &x_ear, &x_val, &x_err  },
-/*X_RE2*/{  &x_err, &x_err, &x_err, &x_rn3, &x_err, &x_rn3, &x_err, &x_err, &x_err, &x_err, /*X_RE2*/ &x_err, &x_err, &x_err, &x_err, &x_err, &x_err  },
-/*X_RE3*/{  &x_err, &x_err, &x_err,      0, &x_err, &x_err, &x_enu, &x_err, &x_err, &x_err, /*X_RE3*/ &x_err, &x_eob, &x_err, &x_ear, &x_val, &x_err  },
-/*X_ATR*/{  &x_var, &x_var, &x_err, &x_err, &x_err, &x_err, &x_ign, &x_bst, &x_err, &x_err, /*X_ATR*/ &x_err, &x_eob, &x_err, &x_err, &x_err, &x_err  },
-/*X_SEO*/{  &x_err, &x_err, &x_err, &x_err, &x_err, &x_err, &x_ign, &x_err, &x_err, &x_err, /*X_SEO*/ &x_err, &x_eob, &x_err, &x_err, &x_val, &x_err  },
-/*X_SEA*/{  &x_err, &x_err, &x_err, &x_err, &x_err, &x_err, &x_ign, &x_err, &x_err, &x_err, /*X_SEA*/ &x_err, &x_err, &x_err, &x_ear, &x_val, &x_err  },
-/*X_EAT*/{  &x_err, &x_err, &x_err, &x_err, &x_err, &x_err, &x_ign, &x_err, &x_err, &x_atr, /*X_EAT*/ &x_ob2, &x_err, &x_ar2, &x_err, &x_err, &x_err  },
+/*            C_AZ,   C_Ee,  C_Uni,  C_Num,  C_Fra, C_Sig,    C_Sp,   C_Ws,  C_Str,  C_Bsl,  C_Col,            C_LCu,  C_RCu,  C_LSq,  C_RSq,  C_Sep,  C_Err */
+/*X_DOC*/{  &x_var, &x_var, &x_err, &x_err, &x_err, &x_err, &x_ign, &x_ign, &x_bst, &x_err, &x_err, /*X_DOC*/ &x_doc, &x_err, &x_err, &x_err, &x_err, &x_err  },
+/*X_VAR*/{       0,      0, &x_err,      0, &x_err, &x_err, &x_est, &x_est, &x_err, &x_err, &x_atr, /*X_VAR*/ &x_ob2, &x_eob, &x_ar2, &x_ear, &x_val, &x_err  },
+/*X_STR*/{       0,      0,      0,      0,      0,      0,      0, &x_err, &x_est, &x_bsc,      0, /*X_STR*/      0,      0,      0,      0,      0, &x_err  },
+/*X_SCH*/{  &x_esc, &x_err, &x_err, &x_err, &x_err, &x_err, &x_err, &x_err, &x_esc, &x_esc, &x_err, /*X_STR*/ &x_err, &x_err, &x_err, &x_err, &x_err, &x_err  },
+/*X_VAL*/{  &x_var, &x_var, &x_err, &x_int, &x_err, &x_sg1, &x_ign, &x_ign, &x_bst, &x_err, &x_err, /*X_VAL*/ &x_ob1, &x_err, &x_ar1, &x_ear, &x_val, &x_err  },
+/*X_INT*/{  &x_err, &x_re2, &x_err,      0, &x_re1, &x_err, &x_enu, &x_enu, &x_err, &x_err, &x_err, /*X_INT*/ &x_err, &x_eob, &x_err, &x_ear, &x_val, &x_err  },
+/*X_RE1*/{  &x_err, &x_re2, &x_err,      0, &x_err, &x_err, &x_enu, &x_enu, &x_err, &x_err, &x_err, /*X_RE1*/ &x_err, &x_eob, &x_err, &x_ear, &x_val, &x_err  },
+/*X_RE2*/{  &x_err, &x_err, &x_err, &x_rn3, &x_err, &x_rn3, &x_err, &x_err, &x_err, &x_err, &x_err, /*X_RE2*/ &x_err, &x_err, &x_err, &x_err, &x_err, &x_err  },
+/*X_RE3*/{  &x_err, &x_err, &x_err,      0, &x_err, &x_err, &x_enu, &x_enu, &x_err, &x_err, &x_err, /*X_RE3*/ &x_err, &x_eob, &x_err, &x_ear, &x_val, &x_err  },
+/*X_ATR*/{  &x_var, &x_var, &x_err, &x_err, &x_err, &x_err, &x_ign, &x_ign, &x_bst, &x_err, &x_err, /*X_ATR*/ &x_err, &x_eob, &x_err, &x_err, &x_err, &x_err  },
+/*X_SEO*/{  &x_err, &x_err, &x_err, &x_err, &x_err, &x_err, &x_ign, &x_ign, &x_err, &x_err, &x_err, /*X_SEO*/ &x_err, &x_eob, &x_err, &x_err, &x_val, &x_err  },
+/*X_SEA*/{  &x_err, &x_err, &x_err, &x_err, &x_err, &x_err, &x_ign, &x_ign, &x_err, &x_err, &x_err, /*X_SEA*/ &x_err, &x_err, &x_err, &x_ear, &x_val, &x_err  },
+/*X_EAT*/{  &x_err, &x_err, &x_err, &x_err, &x_err, &x_err, &x_ign, &x_ign, &x_err, &x_err, &x_atr, /*X_EAT*/ &x_ob2, &x_err, &x_ar2, &x_err, &x_err, &x_err  },
     };
 
+    void appendUtf8(uint code, QByteArray* out)
+    {
+        if(code < 0x80)
+        {
+            out->append(static_cast<char>(code));
+        }
+        else if(code < 0x800)
+        {
+            out->append(static_cast<char>(0xC0 | (code >> 6)));
+            out->append(static_cast<char>(0x80 | (code & 0x3F)));
+        }
+        else if(code < 0x10000)
+        {
+            out->append(static_cast<char>(0xE0 | (code >> 12)));
+            out->append(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+            out->append(static_cast<char>(0x80 | (code & 0x3F)));
+        }
+        else
+        {
+            out->append(static_cast<char>(0xF0 | (code >> 18)));
+            out->append(static_cast<char>(0x80 | ((code >> 12) & 0x3F)));
+            out->append(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+            out->append(static_cast<char>(0x80 | (code & 0x3F)));
+        }
+    }
+
+    bool parseHex4(const char* c_ptr, const char* end, uint* code)
+    {
+        if(end - c_ptr < 4)
+        {
+            return false;
+        }
+
+        (*code) = 0;
+        for(int i = 0; i < 4; i++, c_ptr++)
+        {
+            (*code) <<= 4;
+            if(*c_ptr >= '0' && *c_ptr <= '9')
+            {
+                (*code) |= (*c_ptr - '0');
+            }
+            else if(*c_ptr >= 'a' && *c_ptr <= 'f')
+            {
+                (*code) |= (*c_ptr - 'a' + 10);
+            }
+            else if(*c_ptr >= 'A' && *c_ptr <= 'F')
+            {
+                (*code) |= (*c_ptr - 'A' + 10);
+            }
+            else
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+//\uXXXX sequences are converted to UTF-8, surrogate pairs are joined
+//to one code point and unpaired surrogates are replaced by U+FFFD
+bool FwJSON::unescapeUtf8(const char* c_ptr, int size, QByteArray* out)
+{
+    const char* end = c_ptr + size;
+    out->reserve(size);
+    while(c_ptr != end)
+    {
+        const char* escape = static_cast<const char*>(memchr(c_ptr, '\\', end - c_ptr));
+        if(!escape)
+        {
+            out->append(c_ptr, end - c_ptr);
+            return true;
+        }
+        out->append(c_ptr, escape - c_ptr);
+
+        c_ptr = escape + 1;
+        if(c_ptr == end)
+        {
+            return false;
+        }
+
+        switch(*c_ptr)
+        {
+        case '"':
+        case '\\':
+        case '/':
+            out->append(*c_ptr);
+            break;
+
+        case 'b':
+            out->append('\b');
+            break;
+
+        case 'f':
+            out->append('\f');
+            break;
+
+        case 'n':
+            out->append('\n');
+            break;
+
+        case 'r':
+            out->append('\r');
+            break;
+
+        case 't':
+            out->append('\t');
+            break;
+
+        case 'u':
+            {
+                uint code = 0;
+                if(!parseHex4(c_ptr + 1, end, &code))
+                {
+                    return false;
+                }
+                c_ptr += 4;
+
+                if(code >= 0xD800 && code < 0xDC00)
+                {
+                    uint low = 0;
+                    if(end - c_ptr > 2 && c_ptr[1] == '\\' && c_ptr[2] == 'u' &&
+                       parseHex4(c_ptr + 3, end, &low) && low >= 0xDC00 && low < 0xE000)
+                    {
+                        code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                        c_ptr += 6;
+                    }
+                    else
+                    {
+                        code = 0xFFFD;
+                    }
+                }
+                else if(code >= 0xDC00 && code < 0xE000)
+                {
+                    code = 0xFFFD;
+                }
+                appendUtf8(code, out);
+            }
+            break;
+
+        default:
+            return false;
+        }
+        c_ptr++;
+    }
+    return true;
+}
+
+bool FwJSON::escapeUtf8(const QString& string, QByteArray* out)
+{
+    static const char hexDigits[] = "0123456789abcdef";
+
+    QByteArray utf8 = string.toUtf8();
+    out->clear();
+    out->reserve(utf8.size());
+
+    bool escaped = false;
+    foreach(char c, utf8)
+    {
+        switch(c)
+        {
+        case '"':
+            out->append("\\\"");
+            break;
+
+        case '\\':
+            out->append("\\\\");
+            break;
+
+        case '\b':
+            out->append("\\b");
+            break;
+
+        case '\f':
+            out->append("\\f");
+            break;
+
+        case '\n':
+            out->append("\\n");
+            break;
+
+        case '\r':
+            out->append("\\r");
+            break;
+
+        case '\t':
+            out->append("\\t");
+            break;
+
+        default:
+            if(static_cast<quint8>(c) < 0x20)
+            {
+                out->append("\\u00");
+                out->append(hexDigits[static_cast<quint8>(c) >> 4]);
+                out->append(hexDigits[c & 0xF]);
+                break;
+            }
+            out->append(c);
+            continue;
+        }
+        escaped = true;
+    }
+    return escaped;
+}
+
+namespace
+{
+    //Previous object of the same array, records of one shape have the
+    //same attributes in the same order
+    const FwJSON::Object* previousRecord(const FwJSON::Object* object)
+    {
+        //Items of packed and columnar arrays are not nodes, item() would
+        //unpack them
+        const FwJSON::Array* array = FwJSON::cast<FwJSON::Array>(object->parent());
+        if(!array || array->isPacked() || array->isColumnar())
+        {
+            return nullptr;
+        }
+
+        int size = array->size();
+        if(size < 2 || array->item(size - 1) != object)
+        {
+            return nullptr;
+        }
+        return FwJSON::cast<FwJSON::Object>(array->item(size - 2));
+    }
+
     struct ParseData
     {
         ParseData();
 
+        void begin(FwJSON::Object* root, const QByteArray& utf8String);
+        inline void clearBuffer();
+        inline void enterStructure();
         inline void setupAttributeName();
         inline void structureUp();
         void setupValue();
         inline void setupAttributeValue();
         inline void setupArrayValue();
+        inline bool hasValue() const;
+        inline FwJSON::String* takeString();
+
+        //Adds the value to the parent object under the attribute name
+        //with its hash, see FwJSON::Parser::Data
+        virtual FwJSON::Node* addAttribute(FwJSON::Node* value) = 0;
+
+        //Appends the value to the parent array
+        virtual FwJSON::Node* addItem(FwJSON::Node* value) = 0;
+        virtual void addNumberItem(double value) = 0;
 
+        //The parsed document is merged into the root, the nodes under it
+        //are built by the parser
+        FwJSON::Object* root;
         FwJSON::Node* parent;
         QByteArray attribute;
+        uint attributeHash;
+
+        //Attributes count of the previous record, the first attribute
+        //reserves the storage of the object for them
+        int recordSize;
         bool specialChar;
         QByteArray buffer;
         bool isVariable;
@@ -153,10 +408,29 @@ namespace
         quint32 uintNumber;
         bool declareRoot;
         FwJSON::Type type;
+
+        //Quoted strings are not copied to the buffer, they are kept
+        //as [stringBegin, stringEnd) range of the source
+        QByteArray source;
+        int position;
+        int stringBegin;
+        int stringEnd;
+        bool stringEscaped;
+        FwJSON::ParseOptions options;
+
+        int depth;
+        int maxDepth;
+
+        //Attribute names shared between documents
+        QSet<QByteArray> names;
+        int namesLimit;
     };
 
     ParseData::ParseData() :
+        root(0),
         parent(0),
+        attributeHash(0),
+        recordSize(0),
         specialChar(false),
         isVariable(false),
         xcmd(X_DOC),
@@ -164,19 +438,148 @@ namespace
         column(0),
         uintNumber(0),
         declareRoot(false),
-        type(FwJSON::Type::Null)
+        type(FwJSON::Type::Null),
+        position(0),
+        stringBegin(0),
+        stringEnd(0),
+        stringEscaped(false),
+        depth(0),
+        maxDepth(0),
+        namesLimit(0)
+    {
+        //Keeps the capacity when the buffer is cleared
+        buffer.reserve(64);
+    }
+
+    void ParseData::begin(FwJSON::Object* root, const QByteArray& utf8String)
+    {
+        this->root = root;
+        parent = root;
+        attribute = QByteArray();
+        specialChar = false;
+        clearBuffer();
+        isVariable = false;
+        xcmd = X_DOC;
+        line = 1;
+        column = 0;
+        uintNumber = 0;
+        declareRoot = false;
+        type = FwJSON::Type::Null;
+        source = utf8String;
+        position = 0;
+        stringBegin = 0;
+        stringEnd = 0;
+        stringEscaped = false;
+        depth = 1;
+    }
+
+    void ParseData::clearBuffer()
+    {
+        buffer.resize(0);
+    }
+
+    void ParseData::enterStructure()
     {
+        depth++;
+        if(maxDepth > 0 && depth > maxDepth)
+        {
+            throw FwJSON::Exception("Nesting is deeper than the limit", line, column);
+        }
     }
 
     void ParseData::setupAttributeName()
     {
-        attribute = buffer;
-        buffer = QByteArray();
+        if(isVariable)
+        {
+            attribute = buffer;
+            attributeHash = FwJSON::hashName(attribute.constData(), attribute.size());
+            recordSize = 0;
+            clearBuffer();
+        }
+        else
+        {
+            //Arrays of records repeat the names of the previous record,
+            //the equal name is shared instead of copied and its hash is
+            //known
+            const char* name = source.constData() + stringBegin;
+            int size = stringEnd - stringBegin;
+            const FwJSON::Object* object = static_cast<FwJSON::Object*>(parent);
+            const FwJSON::Object* record = previousRecord(object);
+            int index = object->attributesCount();
+            const FwJSON::Attribute* predicted = record && index < record->attributesCount() ?
+                                                 record->begin() + index : nullptr;
+            recordSize = record ? record->attributesCount() : 0;
+            if(predicted && predicted->name.size() == size && memcmp(predicted->name.constData(), name, size) == 0)
+            {
+                attribute = predicted->name;
+                attributeHash = predicted->hash;
+                stringBegin = stringEnd = 0;
+                return;
+            }
+
+            if(namesLimit > 0)
+            {
+                QSet<QByteArray>::const_iterator found = names.constFind(QByteArray::fromRawData(name, size));
+                if(found != names.constEnd())
+                {
+                    attribute = *found;
+                }
+                else
+                {
+                    attribute = QByteArray(name, size);
+                    if(names.size() < namesLimit)
+                    {
+                        names.insert(attribute);
+                    }
+                }
+            }
+            else
+            {
+                attribute = source.mid(stringBegin, size);
+            }
+            attributeHash = FwJSON::hashName(name, size);
+            stringBegin = stringEnd = 0;
+        }
+    }
+
+    bool ParseData::hasValue() const
+    {
+        return !buffer.isEmpty() || (type == FwJSON::Type::String && !isVariable);
+    }
+
+    FwJSON::String* ParseData::takeString()
+    {
+        FwJSON::String* string = 0;
+        if(isVariable)
+        {
+            string = new FwJSON::String(QString::fromUtf8(buffer));
+        }
+        else if(stringEscaped && options.testFlag(FwJSON::DecodeEscapes))
+        {
+            QByteArray value;
+            if(!FwJSON::unescapeUtf8(source.constData() + stringBegin, stringEnd - stringBegin, &value))
+            {
+                throw FwJSON::Exception("Invalid escape sequence", line, column);
+            }
+            string = new FwJSON::String(source, stringBegin, stringEnd - stringBegin, QString::fromUtf8(value));
+        }
+        else
+        {
+            string = new FwJSON::String(source, stringBegin, stringEnd - stringBegin, stringEscaped);
+        }
+        clearBuffer();
+        stringBegin = stringEnd = 0;
+        return string;
     }
 
     void ParseData::structureUp()
     {
         setupValue();
+        depth--;
+        if(parent->type() == FwJSON::Type::Array && options.testFlag(FwJSON::ColumnarArrays))
+        {
+            static_cast<FwJSON::Array*>(parent)->toColumnar();
+        }
         parent = parent->parent();
         if(parent)
         {
@@ -225,24 +628,22 @@ namespace
         {
         case FwJSON::Type::String:
             {
-                if(isVariable)
+                bool bOk = false;
+                bool value = isVariable ? FwJSON::nameToBool(buffer, &bOk) : false;
+                if(bOk)
                 {
-                    bool bOk = false;
-                    bool value = FwJSON::nameToBool(buffer, &bOk);
-                    if(bOk)
-                    {
-                        static_cast<FwJSON::Object*>(parent)->addBoolean(attribute, value);
-                    }
-                    else
-                    {
-                        static_cast<FwJSON::Object*>(parent)->addString(attribute, QString::fromUtf8(buffer));
-                    }
+                    addAttribute(new FwJSON::Boolean(value));
+                    clearBuffer();
+                }
+                else if(isVariable && buffer == FwJSON::constantNull)
+                {
+                    addAttribute(new FwJSON::Null());
+                    clearBuffer();
                 }
                 else
                 {
-                    static_cast<FwJSON::Object*>(parent)->addString(attribute, QString::fromUtf8(buffer));
+                    addAttribute(takeString());
                 }
-                buffer = QByteArray();
             }
             break;
 
@@ -254,17 +655,19 @@ namespace
                 {
                     throw FwJSON::Exception("Invalid number value", line, column);
                 }
-                static_cast<FwJSON::Object*>(parent)->addNumber(attribute, value);
-                buffer = QByteArray();
+                addAttribute(new FwJSON::Number(value));
+                clearBuffer();
             }
             break;
 
         case FwJSON::Type::Array:
-            parent = static_cast<FwJSON::Object*>(parent)->addArray(attribute);
+            enterStructure();
+            parent = addAttribute(new FwJSON::Array());
             break;
 
         case FwJSON::Type::Object:
-            parent = static_cast<FwJSON::Object*>(parent)->addObject(attribute);
+            enterStructure();
+            parent = addAttribute(new FwJSON::Object());
             break;
 
         case FwJSON::Type::Null:
@@ -284,24 +687,22 @@ namespace
         {
         case FwJSON::Type::String:
             {
-                if(isVariable)
+                bool bOk = false;
+                bool value = isVariable ? FwJSON::nameToBool(buffer, &bOk) : false;
+                if(bOk)
                 {
-                    bool bOk = false;
-                    bool value = FwJSON::nameToBool(buffer, &bOk);
-                    if(bOk)
-                    {
-                        static_cast<FwJSON::Array*>(parent)->addBoolean(value);
-                    }
-                    else
-                    {
-                        static_cast<FwJSON::Array*>(parent)->addString(QString::fromUtf8(buffer));
-                    }
+                    addItem(new FwJSON::Boolean(value));
+                    clearBuffer();
+                }
+                else if(isVariable && buffer == FwJSON::constantNull)
+                {
+                    addItem(new FwJSON::Null());
+                    clearBuffer();
                 }
                 else
                 {
-                    static_cast<FwJSON::Array*>(parent)->addString(QString::fromUtf8(buffer));
+                    addItem(takeString());
                 }
-                buffer = QByteArray();
             }
             break;
 
@@ -313,17 +714,19 @@ namespace
                 {
                     throw FwJSON::Exception("Invalid number value", line, column);
                 }
-                static_cast<FwJSON::Array*>(parent)->addNumber(value);
-                buffer = QByteArray();
+                addNumberItem(value);
+                clearBuffer();
             }
             break;
 
         case FwJSON::Type::Array:
-            parent = static_cast<FwJSON::Array*>(parent)->addArray();
+            enterStructure();
+            parent = addItem(new FwJSON::Array());
             break;
 
         case FwJSON::Type::Object:
-            parent = static_cast<FwJSON::Array*>(parent)->addObject();
+            enterStructure();
+            parent = addItem(new FwJSON::Object());
             break;
 
         case FwJSON::Type::Null:
@@ -364,6 +767,8 @@ namespace
             data->type = FwJSON::Type::String;
             data->xcmd = X_STR;
             data->isVariable = false;
+            data->stringBegin = data->position + 1;
+            data->stringEscaped = false;
             return;
         }
         throw FwJSON::Exception(c, data->line, data->column);
@@ -372,6 +777,10 @@ namespace
     void x_est(char c, ParseData* data)
     {
         Q_UNUSED(c);
+        if(!data->isVariable)
+        {
+            data->stringEnd = data->position;
+        }
         switch(data->parent->type())
         {
         case FwJSON::Type::Array:
@@ -391,7 +800,7 @@ namespace
     void x_bsc(char c, ParseData* data)
     {
         Q_UNUSED(c);
-        data->buffer += '\\';
+        data->stringEscaped = true;
         data->xcmd = X_SCH;
     }
 
@@ -408,7 +817,6 @@ namespace
         case 'r':
         case 't':
         case 'u':
-            data->buffer += c;
             data->xcmd = X_STR;
             break;
 
@@ -574,76 +982,298 @@ namespace
 
 ////////////////////////////////////////////////////////////////////////////////
 
-bool FwJSON::nameToBool(const QByteArray& value, bool* bOk)
+struct FwJSON::Parser::Data final : public ParseData
 {
-    if(bOk) (*bOk) = false;
-    if(!value.isEmpty())
+    FwJSON::Node* addAttribute(FwJSON::Node* value) override
     {
-
-        if(value == "true")
+        FwJSON::Object* object = static_cast<FwJSON::Object*>(parent);
+        if(object->m_attributes.isEmpty() && recordSize > 0)
         {
-            if(bOk) (*bOk) = true;
-            return true;
+            object->m_attributes.reserve(recordSize);
         }
-        else if(value == "false")
+        if(object == root)
         {
-            if(bOk) (*bOk) = true;
-            return false;
+            return object->addAttribute(attribute, attributeHash, value, true);
         }
+        return object->addParsedAttribute(attribute, attributeHash, value);
     }
 
-    return false;
-}
+    FwJSON::Node* addItem(FwJSON::Node* value) override
+    {
+        return static_cast<FwJSON::Array*>(parent)->addParsedValue(value);
+    }
 
-QByteArray FwJSON::boolToName(bool value)
+    void addNumberItem(double value) override
+    {
+        FwJSON::Array* array = static_cast<FwJSON::Array*>(parent);
+        if(options.testFlag(FwJSON::PackNumericArrays))
+        {
+            array->appendParsedNumber(value);
+        }
+        else
+        {
+            array->addParsedValue(new FwJSON::Number(value));
+        }
+    }
+};
+
+FwJSON::Parser::Parser(FwJSON::ParseOptions options) :
+    m_options(options),
+    m_maxDepth(0),
+    m_maxSize(0),
+    m_namesLimit(0),
+    m_data(new Data())
 {
-    return value ? "true": "false";
 }
 
-////////////////////////////////////////////////////////////////////////////////
-
-FwJSON::Node::Node()
-{}
+FwJSON::Parser::~Parser()
+{
+    delete m_data;
+}
 
-FwJSON::Node::~Node()
+void FwJSON::Parser::clearNames()
 {
-    takeFromParent();
+    m_data->names.clear();
 }
 
-QByteArray FwJSON::Node::name() const
+void FwJSON::Parser::parse(const QByteArray& utf8String, FwJSON::Object* object)
 {
-    if (parent_)
+    if(utf8String.isEmpty())
     {
-        switch(parent_->type())
-        {
-        case FwJSON::Type::Object:
-            return cast<FwJSON::Object>(parent_)->attributeName(const_cast<FwJSON::Node*>(this));
-
-        case FwJSON::Type::Array:
-            return "[" + QByteArray::number(cast<FwJSON::Array>(parent_)->indexOf(const_cast<FwJSON::Node*>(this))) + "]";
-
-        default:
-            Q_ASSERT(false);
-            break;
-        }
+        throw FwJSON::Exception("Input string is empty");
     }
-    else if(type() == FwJSON::Type::Object || type() == FwJSON::Type::Array)
+    if(m_maxSize > 0 && utf8String.size() > m_maxSize)
     {
-        return "root";
+        throw FwJSON::Exception("Input is larger than the limit");
     }
-    return "";
-}
 
-void FwJSON::Node::takeFromParent()
-{
-    if (parent_)
+    ParseData& data = *m_data;
+    data.options = m_options;
+    data.maxDepth = m_maxDepth;
+    data.namesLimit = m_namesLimit;
+    data.begin(object, utf8String);
+    try
     {
-        switch (parent_->type())
+        const char* c_ptr = utf8String.constData();
+        int size = utf8String.size();
+        for(;data.position < size; data.position++, data.column++, c_ptr++)
         {
-        case FwJSON::Type::Object:
+            quint8 nextChar = static_cast<quint8>(*c_ptr);
+
+            CharType charType = nextChar < 128 ? chars_type[nextChar] : C_Uni;
+            if(CommandFunc cmd = parse_commands[data.xcmd][charType])
+            {
+                cmd((*c_ptr), &data);
+            }
+            else if(data.xcmd != X_STR)
+            {
+                data.buffer += (*c_ptr);
+            }
+
+            if(nextChar == '\n')
+            {
+                data.line++;
+                data.column = -1;
+            }
+        }
+
+        if(data.parent && data.hasValue())
+        {
+            data.setupValue();
+        }
+
+    }
+    catch(const FwJSON::Exception& e)
+    {
+        data.begin(nullptr, QByteArray());
+        object->clear();
+        throw e;
+    }
+
+    //String nodes hold the source themselves
+    data.begin(nullptr, QByteArray());
+}
+
+void FwJSON::Parser::parse(QIODevice* ioDevice, FwJSON::Object* object)
+{
+    if(!ioDevice->isOpen() && !ioDevice->open(QIODevice::ReadOnly | QIODevice::Text))
+    {
+        object->clear();
+        throw FwJSON::Exception(ioDevice->errorString().toUtf8());
+    }
+
+    //String nodes keep referencing this buffer
+    QByteArray utf8String = ioDevice->readAll();
+    if(!utf8String.isEmpty())
+    {
+        parse(utf8String, object);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool FwJSON::nameToBool(const QByteArray& value, bool* bOk)
+{
+    if(bOk) (*bOk) = false;
+    if(!value.isEmpty())
+    {
+
+        if(value == "true")
+        {
+            if(bOk) (*bOk) = true;
+            return true;
+        }
+        else if(value == "false")
+        {
+            if(bOk) (*bOk) = true;
+            return false;
+        }
+    }
+
+    return false;
+}
+
+QByteArray FwJSON::boolToName(bool value)
+{
+    return value ? "true": "false";
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+    const size_t poolGranularity = 16;
+    const int poolClasses = 16;
+    const int poolLimit = 4096;
+
+    struct FreeNode
+    {
+        FreeNode* next;
+    };
+
+    //Trivially destructible, so it stays usable while other thread
+    //local and static objects holding nodes are destroyed
+    struct NodePool
+    {
+        FreeNode* nodes[poolClasses];
+        int counts[poolClasses];
+        bool registered;
+        bool released;
+    };
+
+    thread_local NodePool nodePool;
+
+    struct NodePoolCleaner
+    {
+        ~NodePoolCleaner()
+        {
+            FwJSON::Node::releaseFreeNodes();
+            nodePool.released = true;
+        }
+    };
+
+    inline int poolClass(size_t size)
+    {
+        return static_cast<int>((size - 1) / poolGranularity);
+    }
+}
+
+void* FwJSON::Node::operator new(size_t size)
+{
+    int index = poolClass(size);
+    if(index >= poolClasses)
+    {
+        return ::operator new(size);
+    }
+
+    if(FreeNode* node = nodePool.nodes[index])
+    {
+        nodePool.nodes[index] = node->next;
+        nodePool.counts[index]--;
+        return node;
+    }
+
+    //Nodes of one class have the same size to be interchangeable
+    return ::operator new((index + 1) * poolGranularity);
+}
+
+void FwJSON::Node::operator delete(void* pointer, size_t size)
+{
+    int index = poolClass(size);
+    if(index >= poolClasses || nodePool.released || nodePool.counts[index] >= poolLimit)
+    {
+        ::operator delete(pointer);
+        return;
+    }
+
+    if(!nodePool.registered)
+    {
+        static thread_local NodePoolCleaner cleaner;
+        Q_UNUSED(cleaner);
+        nodePool.registered = true;
+    }
+
+    FreeNode* node = static_cast<FreeNode*>(pointer);
+    node->next = nodePool.nodes[index];
+    nodePool.nodes[index] = node;
+    nodePool.counts[index]++;
+}
+
+void FwJSON::Node::releaseFreeNodes()
+{
+    for(int index = 0; index < poolClasses; index++)
+    {
+        while(FreeNode* node = nodePool.nodes[index])
+        {
+            nodePool.nodes[index] = node->next;
+            ::operator delete(node);
+        }
+        nodePool.counts[index] = 0;
+    }
+}
+
+FwJSON::Node::Node()
+{}
+
+FwJSON::Node::~Node()
+{
+    takeFromParent();
+}
+
+QByteArray FwJSON::Node::name() const
+{
+    if (parent_)
+    {
+        switch(parent_->type())
+        {
+        case FwJSON::Type::Object:
+            return cast<FwJSON::Object>(parent_)->attributeName(const_cast<FwJSON::Node*>(this));
+
+        case FwJSON::Type::Array:
+            return "[" + QByteArray::number(cast<FwJSON::Array>(parent_)->indexOf(const_cast<FwJSON::Node*>(this))) + "]";
+
+        default:
+            Q_ASSERT(false);
+            break;
+        }
+    }
+    else if(type() == FwJSON::Type::Object || type() == FwJSON::Type::Array)
+    {
+        return "root";
+    }
+    return "";
+}
+
+void FwJSON::Node::takeFromParent()
+{
+    if (parent_)
+    {
+        switch (parent_->type())
+        {
+        case FwJSON::Type::Object:
             {
                 FwJSON::Object* object = static_cast<FwJSON::Object*>(parent_);
-                object->m_attributes.remove(object->m_attributes.key(this));
+                object->removeAttributeAt(object->indexOf(this));
             }
             break;
 
@@ -651,6 +1281,7 @@ void FwJSON::Node::takeFromParent()
             {
                 FwJSON::Array* array = static_cast<FwJSON::Array*>(parent_);
                 array->m_data.remove(array->m_data.indexOf(this));
+                array->invalidate();
             }
             break;
 
@@ -658,478 +1289,2541 @@ void FwJSON::Node::takeFromParent()
             Q_ASSERT(false);
             break;
         }
-        parent_ = nullptr;
+        parent_ = nullptr;
+    }
+}
+
+void FwJSON::Node::invalidate()
+{
+    //A cached hash, form or emptiness depends only on descendants with
+    //something cached, so the walk stops at the first ancestor with
+    //nothing cached. Nodes created under a cached parent reset it, see
+    //FwJSON::Array::materialize()
+    FwJSON::Node* node = this;
+    do
+    {
+        Q_ASSERT(!node->frozen_);
+        node->hashed_ = false;
+        node->emptyChecked_ = false;
+        if(!node->utf8_.isNull())
+        {
+            node->utf8_ = QByteArray();
+        }
+        node = node->parent_;
+    }
+    while(node && (node->hashed_ || node->emptyChecked_ || !node->utf8_.isNull()));
+}
+
+void FwJSON::Node::write(FwJSON::Writer* writer) const
+{
+    if(isEmptyUtf8(this))
+    {
+        return;
+    }
+
+    //Cached forms are taken from the buffer, the device writer may
+    //have sent a part of the output already
+    bool cache = false;
+    if(const FwJSON::Object* object = cast<FwJSON::Object>(this))
+    {
+        cache = object->isUtf8Cached() && object->utf8_.isNull();
+    }
+    else if(const FwJSON::Array* array = cast<FwJSON::Array>(this))
+    {
+        cache = array->isUtf8Cached() && array->utf8_.isNull();
+    }
+    if(!cache || writer->device())
+    {
+        writeUtf8(this, writer, nullptr);
+        return;
+    }
+
+    QVector<Utf8Range> cached;
+    QByteArray* buffer = writer->buffer();
+    int begin = buffer->size();
+    writeUtf8(this, writer, &cached);
+
+    //The serialized containers share one copy of the output, the buffer
+    //itself if the output is all it holds
+    QByteArray utf8;
+    if(begin == 0)
+    {
+        buffer->squeeze();
+        utf8 = *buffer;
+    }
+    else
+    {
+        utf8 = buffer->mid(begin);
+    }
+    foreach(const Utf8Range& range, cached)
+    {
+        range.node->utf8_ = utf8;
+        if(range.node->type() == FwJSON::Type::Object)
+        {
+            const FwJSON::Object* object = static_cast<const FwJSON::Object*>(range.node);
+            object->m_utf8Offset = range.offset - begin;
+            object->m_utf8Size = range.size;
+        }
+        else
+        {
+            const FwJSON::Array* array = static_cast<const FwJSON::Array*>(range.node);
+            array->m_utf8Offset = range.offset - begin;
+            array->m_utf8Size = range.size;
+        }
+    }
+}
+
+void FwJSON::Node::writeUtf8(const FwJSON::Node* node, FwJSON::Writer* writer, QVector<Utf8Range>* cached)
+{
+    const char* data;
+    int size;
+    if(cachedUtf8(node, &data, &size))
+    {
+        writer->writeRaw(data, size);
+        return;
+    }
+
+    switch(node->type())
+    {
+    case FwJSON::Type::Object:
+        static_cast<const FwJSON::Object*>(node)->serialize(writer, cached);
+        break;
+
+    case FwJSON::Type::Array:
+        static_cast<const FwJSON::Array*>(node)->serialize(writer, cached);
+        break;
+
+    case FwJSON::Type::String:
+        {
+            //Like FwJSON::String::toUtf8() without the temporary copy
+            const FwJSON::String* string = static_cast<const FwJSON::String*>(node);
+            writer->writeRaw('"');
+            if(string->m_source.isNull())
+            {
+                QByteArray utf8 = string->m_value.toUtf8();
+                writer->writeRaw(utf8.constData(), utf8.size());
+            }
+            else
+            {
+                writer->writeRaw(string->m_source.constData() + string->m_offset, string->m_size);
+            }
+            writer->writeRaw('"');
+        }
+        break;
+
+    case FwJSON::Type::Number:
+        writer->write(static_cast<const FwJSON::Number*>(node)->value());
+        break;
+
+    case FwJSON::Type::Bool:
+        writer->write(static_cast<const FwJSON::Boolean*>(node)->value());
+        break;
+
+    case FwJSON::Type::Null:
+        writer->writeNull();
+        break;
+    }
+}
+
+bool FwJSON::Node::cachedUtf8(const FwJSON::Node* node, const char** data, int* size)
+{
+    if(node->utf8_.isNull())
+    {
+        return false;
+    }
+
+    int offset;
+    if(node->type() == FwJSON::Type::Object)
+    {
+        const FwJSON::Object* object = static_cast<const FwJSON::Object*>(node);
+        offset = object->m_utf8Offset;
+        *size = object->m_utf8Size;
+    }
+    else
+    {
+        Q_ASSERT(node->type() == FwJSON::Type::Array);
+        const FwJSON::Array* array = static_cast<const FwJSON::Array*>(node);
+        offset = array->m_utf8Offset;
+        *size = array->m_utf8Size;
+    }
+    *data = node->utf8_.constData() + offset;
+    return true;
+}
+
+bool FwJSON::Node::isEmptyUtf8(const FwJSON::Node* node)
+{
+    if(node->type() != FwJSON::Type::Array)
+    {
+        return false;
+    }
+    if(node->emptyChecked_)
+    {
+        return node->empty_;
+    }
+
+    //The result is kept until the subtree changes, serialize() asks
+    //again for every nested array
+    const FwJSON::Array* array = static_cast<const FwJSON::Array*>(node);
+    bool empty = !(array->m_packed && !array->m_numbers.isEmpty()) &&
+                 !(!array->m_columns.isEmpty() && array->m_columns.first().present.size() > 0);
+    for(int i = 0; empty && i < array->m_data.size(); i++)
+    {
+        empty = isEmptyUtf8(array->m_data.at(i));
+    }
+    node->empty_ = empty;
+    node->emptyChecked_ = true;
+    return empty;
+}
+
+void FwJSON::Node::clearUtf8Cache(const FwJSON::Node* node)
+{
+    //Frozen forms do not change, copies may share them
+    if(node->frozen_)
+    {
+        return;
+    }
+
+    node->utf8_ = QByteArray();
+    if(const FwJSON::Object* object = cast<FwJSON::Object>(node))
+    {
+        for(const FwJSON::Attribute& attribute : *object)
+        {
+            clearUtf8Cache(attribute.value);
+        }
+    }
+    else if(const FwJSON::Array* array = cast<FwJSON::Array>(node))
+    {
+        foreach(FwJSON::Node* item, array->m_data)
+        {
+            clearUtf8Cache(item);
+        }
+    }
+}
+
+namespace
+{
+    inline uint mixHash(uint hash, uint value)
+    {
+        return (hash ^ value) * 16777619u;
+    }
+
+    inline uint typeHash(FwJSON::Type type)
+    {
+        return mixHash(2166136261u, static_cast<uint>(type));
+    }
+
+    uint numberHash(double value)
+    {
+        //+0 and -0 are equal
+        value += 0.;
+        return typeHash(FwJSON::Type::Number) ^ FwJSON::hashName(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    uint stringHash(const QString& value)
+    {
+        QByteArray utf8 = value.toUtf8();
+        return typeHash(FwJSON::Type::String) ^ FwJSON::hashName(utf8.constData(), utf8.size());
+    }
+
+    inline uint booleanHash(bool value)
+    {
+        return mixHash(typeHash(FwJSON::Type::Bool), value ? 1u : 0u);
+    }
+
+    //Summed up, so the attributes order does not matter
+    inline uint attributeHash(uint nameHash, uint valueHash)
+    {
+        return mixHash(nameHash, valueHash * 2654435761u);
+    }
+
+    //Unescaped value, strings parsed without DecodeEscapes keep the
+    //escape sequences in value()
+    QString stringValue(const QString& value, bool escaped)
+    {
+        if(!escaped)
+        {
+            return value;
+        }
+
+        QByteArray utf8 = value.toUtf8();
+        QByteArray out;
+        return FwJSON::unescapeUtf8(utf8.constData(), utf8.size(), &out) ? QString::fromUtf8(out) : value;
+    }
+
+    uint columnHash(const FwJSON::Column& column, int row)
+    {
+        switch(column.type)
+        {
+        case FwJSON::Type::Number:
+            return numberHash(column.numbers.at(row));
+
+        case FwJSON::Type::Bool:
+            return booleanHash(column.flags.testBit(row));
+
+        case FwJSON::Type::String:
+            return stringHash(stringValue(column.strings.at(row), column.flags.testBit(row)));
+
+        default:
+            Q_ASSERT(false);
+            return 0;
+        }
+    }
+
+    //Const iteration unpacks the arrays
+    void unpackSubtree(const FwJSON::Node* node)
+    {
+        if(const FwJSON::Object* object = FwJSON::cast<FwJSON::Object>(node))
+        {
+            for(const FwJSON::Attribute& attribute : *object)
+            {
+                unpackSubtree(attribute.value);
+            }
+        }
+        else if(const FwJSON::Array* array = FwJSON::cast<FwJSON::Array>(node))
+        {
+            for(const FwJSON::Node* item : *array)
+            {
+                unpackSubtree(item);
+            }
+        }
+    }
+}
+
+void FwJSON::Node::freeze()
+{
+    if(frozen_)
+    {
+        return;
+    }
+
+    //The forms of the whole subtree are stored at once, before nested
+    //cached nodes would store their own. Unpacking resets the forms of
+    //the ancestors, so it comes first
+    if((type() == FwJSON::Type::Object && static_cast<FwJSON::Object*>(this)->isUtf8Cached()) ||
+       (type() == FwJSON::Type::Array && static_cast<FwJSON::Array*>(this)->isUtf8Cached()))
+    {
+        unpackSubtree(this);
+        if(utf8_.isNull())
+        {
+            toUtf8();
+        }
+    }
+
+    switch(type())
+    {
+    case FwJSON::Type::Object:
+        {
+            FwJSON::Object* object = static_cast<FwJSON::Object*>(this);
+            foreach(const FwJSON::Attribute& attribute, object->m_attributes)
+            {
+                attribute.value->freeze();
+            }
+        }
+        break;
+
+    case FwJSON::Type::Array:
+        {
+            FwJSON::Array* array = static_cast<FwJSON::Array*>(this);
+            array->unpack();
+            foreach(FwJSON::Node* item, array->m_data)
+            {
+                item->freeze();
+            }
+        }
+        break;
+
+    case FwJSON::Type::String:
+        //value() converts the text on the first call and keeps it,
+        //later calls change nothing
+        static_cast<FwJSON::String*>(this)->value();
+        break;
+
+    default:
+        break;
+    }
+
+    hash();
+    isEmptyUtf8(this);
+    frozen_ = true;
+}
+
+void FwJSON::Node::update(FwJSON::Node* target, FwJSON::Node* source, QVector<FwJSON::Node*>* changed)
+{
+    Q_ASSERT(target->type() == source->type());
+    bool modified = false;
+    switch(target->type())
+    {
+    case FwJSON::Type::String:
+        {
+            //Unchanged strings reference the new source too, so the
+            //previous one is released
+            FwJSON::String* string = static_cast<FwJSON::String*>(target);
+            const FwJSON::String* other = static_cast<const FwJSON::String*>(source);
+            modified = !string->hasSameText(other);
+            string->m_source = other->m_source;
+            string->m_offset = other->m_offset;
+            string->m_size = other->m_size;
+            string->m_escaped = other->m_escaped;
+            string->m_decoded = other->m_decoded;
+            string->m_value = other->m_value;
+            if(modified)
+            {
+                string->invalidate();
+            }
+        }
+        break;
+
+    case FwJSON::Type::Number:
+        {
+            FwJSON::Number* number = static_cast<FwJSON::Number*>(target);
+            double value = static_cast<const FwJSON::Number*>(source)->value();
+            modified = number->value() != value;
+            if(modified)
+            {
+                number->setValue(value);
+            }
+        }
+        break;
+
+    case FwJSON::Type::Bool:
+        {
+            FwJSON::Boolean* boolean = static_cast<FwJSON::Boolean*>(target);
+            bool value = static_cast<const FwJSON::Boolean*>(source)->value();
+            modified = boolean->value() != value;
+            if(modified)
+            {
+                boolean->setValue(value);
+            }
+        }
+        break;
+
+    case FwJSON::Type::Object:
+        {
+            FwJSON::Object* object = static_cast<FwJSON::Object*>(target);
+            FwJSON::Object* other = static_cast<FwJSON::Object*>(source);
+            object->detach();
+
+            for(int i = object->m_attributes.size() - 1; i >= 0; i--)
+            {
+                const FwJSON::Attribute& attribute = object->m_attributes.at(i);
+                if(other->indexOf(attribute.name.constData(), attribute.name.size(), attribute.hash) < 0)
+                {
+                    delete attribute.value;
+                    modified = true;
+                }
+            }
+
+            //Differing nodes are exchanged with the source ones, which
+            //are deleted together with the source tree
+            QVector<int> added;
+            for(int i = 0; i < other->m_attributes.size(); i++)
+            {
+                FwJSON::Attribute& attribute = other->m_attributes[i];
+                int index = object->indexOf(attribute.name.constData(), attribute.name.size(), attribute.hash);
+                if(index < 0)
+                {
+                    attribute.value->parent_ = object;
+                    object->insertAttribute(attribute.name, attribute.hash, attribute.value);
+                    object->invalidate();
+                    added.append(i);
+                }
+                else if(object->m_attributes.at(index).value->type() != attribute.value->type())
+                {
+                    qSwap(object->m_attributes[index].value, attribute.value);
+                    object->m_attributes[index].value->parent_ = object;
+                    attribute.value->parent_ = other;
+                    object->invalidate();
+                }
+                else
+                {
+                    update(object->m_attributes.at(index).value, attribute.value, changed);
+                    continue;
+                }
+
+                if(changed)
+                {
+                    changed->append(object->m_attributes.at(index < 0 ? object->m_attributes.size() - 1 : index).value);
+                }
+            }
+
+            for(int i = added.size() - 1; i >= 0; i--)
+            {
+                other->m_attributes.remove(added.at(i));
+            }
+            other->updateIndex();
+        }
+        break;
+
+    case FwJSON::Type::Array:
+        {
+            FwJSON::Array* array = static_cast<FwJSON::Array*>(target);
+            FwJSON::Array* other = static_cast<FwJSON::Array*>(source);
+            array->detach();
+
+            //Packed and columnar arrays are replaced as a whole
+            if(array->m_packed || other->m_packed || !array->m_columns.isEmpty() || !other->m_columns.isEmpty())
+            {
+                modified = !array->equals(other);
+                if(modified)
+                {
+                    array->swap(*other);
+                }
+                break;
+            }
+
+            int size = array->m_data.size();
+            int otherSize = other->m_data.size();
+            int common = qMin(size, otherSize);
+            for(int i = 0; i < common; i++)
+            {
+                FwJSON::Node*& item = array->m_data[i];
+                FwJSON::Node*& otherItem = other->m_data[i];
+                if(item->type() == otherItem->type())
+                {
+                    update(item, otherItem, changed);
+                    continue;
+                }
+
+                qSwap(item, otherItem);
+                item->parent_ = array;
+                otherItem->parent_ = other;
+                array->invalidate();
+                if(changed)
+                {
+                    changed->append(item);
+                }
+            }
+
+            //Extra items change places with the source ones
+            for(int i = common; i < otherSize; i++)
+            {
+                FwJSON::Node* item = other->m_data.at(i);
+                item->parent_ = array;
+                array->m_data.append(item);
+                if(changed)
+                {
+                    changed->append(item);
+                }
+            }
+            for(int i = common; i < size; i++)
+            {
+                FwJSON::Node* item = array->m_data.at(i);
+                item->parent_ = other;
+                other->m_data.append(item);
+                modified = true;
+            }
+            array->m_data.remove(common, size - common);
+            other->m_data.remove(common, otherSize - common);
+            if(size != otherSize)
+            {
+                array->invalidate();
+            }
+        }
+        break;
+
+    default:
+        break;
+    }
+
+    if(modified && changed)
+    {
+        changed->append(target);
+    }
+}
+
+bool FwJSON::Node::update(FwJSON::Reader* reader, FwJSON::Node* target, FwJSON::ParseOptions options,
+                          QVector<FwJSON::Node*>* changed)
+{
+    if(reader->peek() != target->type())
+    {
+        return false;
+    }
+
+    bool modified = false;
+    switch(target->type())
+    {
+    case FwJSON::Type::String:
+        {
+            int begin = 0;
+            int end = 0;
+            bool escaped = false;
+            reader->stringRange(&begin, &end, &escaped);
+
+            //Strings reference the new document, which releases the
+            //previous one, and keep the converted value if the text
+            //is the same
+            FwJSON::String* string = static_cast<FwJSON::String*>(target);
+            FwJSON::String other(reader->m_source, begin, end - begin, escaped);
+            modified = !string->hasSameText(&other);
+            string->m_source = reader->m_source;
+            string->m_offset = begin;
+            string->m_size = end - begin;
+            string->m_escaped = escaped;
+            if(modified)
+            {
+                string->m_decoded = false;
+                if(escaped && options.testFlag(FwJSON::DecodeEscapes))
+                {
+                    QByteArray value;
+                    unescapeUtf8(reader->m_begin + begin, end - begin, &value);
+                    string->m_value = QString::fromUtf8(value);
+                    string->m_decoded = true;
+                }
+                string->invalidate();
+            }
+        }
+        break;
+
+    case FwJSON::Type::Number:
+        {
+            FwJSON::Number* number = static_cast<FwJSON::Number*>(target);
+            double value = reader->number();
+            modified = number->value() != value;
+            if(modified)
+            {
+                number->setValue(value);
+            }
+        }
+        break;
+
+    case FwJSON::Type::Bool:
+        {
+            FwJSON::Boolean* boolean = static_cast<FwJSON::Boolean*>(target);
+            bool value = false;
+            reader->read(&value);
+            modified = boolean->value() != value;
+            if(modified)
+            {
+                boolean->setValue(value);
+            }
+        }
+        break;
+
+    case FwJSON::Type::Object:
+        {
+            FwJSON::Object* object = static_cast<FwJSON::Object*>(target);
+            object->detach();
+
+            //Attributes are expected in the order of the previous
+            //document, the seen ones are marked once the order breaks
+            int next = 0;
+            QBitArray seen;
+            int begin = 0;
+            int end = 0;
+            bool escaped = false;
+            reader->beginObject();
+            while(reader->nextAttributeRange(&begin, &end, &escaped))
+            {
+                const char* name = reader->m_begin + begin;
+                int size = end - begin;
+                int index = -1;
+                FwJSON::Node* added = nullptr;
+                if(next < object->m_attributes.size() && object->m_attributes.at(next).name.size() == size &&
+                   memcmp(object->m_attributes.at(next).name.constData(), name, size) == 0)
+                {
+                    index = next;
+                }
+                else
+                {
+                    uint hash = hashName(name, size);
+                    index = object->indexOf(name, size, hash);
+                    if(index < 0)
+                    {
+                        added = readNode(reader, options);
+                        added->parent_ = object;
+                        object->insertAttribute(reader->m_source.mid(begin, size), hash, added);
+                        object->invalidate();
+                        index = object->m_attributes.size() - 1;
+                    }
+                }
+
+                if(seen.isEmpty() && index != next)
+                {
+                    seen = QBitArray(object->m_attributes.size());
+                    seen.fill(true, 0, next);
+                }
+                bool repeated = false;
+                if(!seen.isEmpty())
+                {
+                    seen.resize(object->m_attributes.size());
+                    repeated = seen.testBit(index);
+                    seen.setBit(index);
+                }
+                next = index + 1;
+
+                FwJSON::Node*& value = object->m_attributes[index].value;
+                if(!added && !update(reader, value, options, changed))
+                {
+                    //The last of repeated names wins like in the parser,
+                    //changes reported under the replaced value are dropped
+                    for(int i = (repeated && changed) ? changed->size() - 1 : -1; i >= 0; i--)
+                    {
+                        for(FwJSON::Node* node = changed->at(i); node; node = node->parent_)
+                        {
+                            if(node == value)
+                            {
+                                changed->remove(i);
+                                break;
+                            }
+                        }
+                    }
+
+                    added = readNode(reader, options);
+                    added->parent_ = object;
+                    value->parent_ = nullptr;
+                    delete value;
+                    value = added;
+                    object->invalidate();
+                }
+                if(added && changed)
+                {
+                    changed->append(added);
+                }
+            }
+
+            for(int i = object->m_attributes.size() - 1; i >= 0; i--)
+            {
+                if(seen.isEmpty() ? i >= next : !seen.testBit(i))
+                {
+                    delete object->m_attributes.at(i).value;
+                    modified = true;
+                }
+            }
+        }
+        break;
+
+    case FwJSON::Type::Array:
+        {
+            FwJSON::Array* array = static_cast<FwJSON::Array*>(target);
+            array->detach();
+
+            //Columns are read again and kept if the values are the same
+            if(!array->m_columns.isEmpty())
+            {
+                QScopedPointer<FwJSON::Node> other(readNode(reader, options));
+                modified = !array->equals(other.data());
+                if(modified)
+                {
+                    array->swap(*static_cast<FwJSON::Array*>(other.data()));
+                }
+                break;
+            }
+
+            //Packed numbers are assigned in place until a value of other
+            //type unpacks the array like in the parser
+            const char* start = reader->m_current;
+            if(array->m_packed)
+            {
+                int count = 0;
+                bool numbers = true;
+                reader->beginArray();
+                while(reader->nextItem())
+                {
+                    if(reader->peek() != FwJSON::Type::Number)
+                    {
+                        numbers = false;
+                        break;
+                    }
+
+                    double value = reader->number();
+                    if(count == array->m_numbers.size())
+                    {
+                        array->m_numbers.append(value);
+                        modified = true;
+                    }
+                    else if(array->m_numbers.at(count) != value)
+                    {
+                        array->m_numbers[count] = value;
+                        modified = true;
+                    }
+                    count++;
+                }
+                if(numbers && count < array->m_numbers.size())
+                {
+                    array->m_numbers.resize(count);
+                    modified = true;
+                }
+                if(modified)
+                {
+                    array->invalidate();
+                }
+                if(numbers)
+                {
+                    break;
+                }
+                reader->m_current = start;
+                array->materialize();
+            }
+
+            int count = 0;
+            reader->beginArray();
+            while(reader->nextItem())
+            {
+                if(count < array->m_data.size())
+                {
+                    FwJSON::Node*& item = array->m_data[count];
+                    if(!update(reader, item, options, changed))
+                    {
+                        FwJSON::Node* other = readNode(reader, options);
+                        other->parent_ = array;
+                        item->parent_ = nullptr;
+                        delete item;
+                        item = other;
+                        array->invalidate();
+                        if(changed)
+                        {
+                            changed->append(other);
+                        }
+                    }
+                }
+                else if(options.testFlag(FwJSON::PackNumericArrays) && array->m_data.isEmpty() &&
+                        reader->peek() == FwJSON::Type::Number)
+                {
+                    array->appendNumber(reader->number());
+                    modified = true;
+                }
+                else
+                {
+                    FwJSON::Node* item = array->addValue(readNode(reader, options));
+                    if(changed)
+                    {
+                        changed->append(item);
+                    }
+                }
+                count++;
+            }
+
+            if(count < array->m_data.size())
+            {
+                for(int i = count; i < array->m_data.size(); i++)
+                {
+                    array->m_data.at(i)->parent_ = nullptr;
+                    delete array->m_data.at(i);
+                }
+                array->m_data.remove(count, array->m_data.size() - count);
+                array->invalidate();
+                modified = true;
+            }
+        }
+        break;
+
+    default:
+        reader->readNull();
+        break;
+    }
+
+    if(modified && changed)
+    {
+        changed->append(target);
+    }
+    return true;
+}
+
+FwJSON::Node* FwJSON::Node::readNode(FwJSON::Reader* reader, FwJSON::ParseOptions options)
+{
+    switch(reader->peek())
+    {
+    case FwJSON::Type::Object:
+        {
+            QScopedPointer<FwJSON::Object> object(new FwJSON::Object());
+            int begin = 0;
+            int end = 0;
+            bool escaped = false;
+            reader->beginObject();
+            while(reader->nextAttributeRange(&begin, &end, &escaped))
+            {
+                QByteArray name = reader->m_source.mid(begin, end - begin);
+                object->addParsedAttribute(name, hashName(name.constData(), name.size()), readNode(reader, options));
+            }
+            return object.take();
+        }
+
+    case FwJSON::Type::Array:
+        {
+            QScopedPointer<FwJSON::Array> array(new FwJSON::Array());
+            reader->beginArray();
+            while(reader->nextItem())
+            {
+                if(options.testFlag(FwJSON::PackNumericArrays) && reader->peek() == FwJSON::Type::Number)
+                {
+                    array->appendParsedNumber(reader->number());
+                }
+                else
+                {
+                    array->addParsedValue(readNode(reader, options));
+                }
+            }
+            if(options.testFlag(FwJSON::ColumnarArrays))
+            {
+                array->toColumnar();
+            }
+            return array.take();
+        }
+
+    case FwJSON::Type::String:
+        {
+            int begin = 0;
+            int end = 0;
+            bool escaped = false;
+            reader->stringRange(&begin, &end, &escaped);
+            if(escaped && options.testFlag(FwJSON::DecodeEscapes))
+            {
+                QByteArray value;
+                unescapeUtf8(reader->m_begin + begin, end - begin, &value);
+                return new FwJSON::String(reader->m_source, begin, end - begin, QString::fromUtf8(value));
+            }
+            return new FwJSON::String(reader->m_source, begin, end - begin, escaped);
+        }
+
+    case FwJSON::Type::Number:
+        return new FwJSON::Number(reader->number());
+
+    case FwJSON::Type::Bool:
+        {
+            bool value = false;
+            reader->read(&value);
+            return new FwJSON::Boolean(value);
+        }
+
+    default:
+        reader->readNull();
+        return new FwJSON::Null();
+    }
+}
+
+bool FwJSON::Node::isStrict(const QByteArray& utf8String)
+{
+    try
+    {
+        FwJSON::Reader reader(utf8String);
+        if(reader.peek() != FwJSON::Type::Object)
+        {
+            return false;
+        }
+        reader.skipValue();
+        reader.finish();
+    }
+    catch(const FwJSON::Exception&)
+    {
+        return false;
+    }
+    return true;
+}
+
+uint FwJSON::Node::hash() const
+{
+    if(!hashed_)
+    {
+        hash_ = structuralHash();
+        hashed_ = true;
+    }
+    return hash_;
+}
+
+uint FwJSON::Node::structuralHash() const
+{
+    switch(type())
+    {
+    case FwJSON::Type::String:
+        {
+            const FwJSON::String* string = static_cast<const FwJSON::String*>(this);
+            return stringHash(stringValue(string->value(), string->hasEscapes()));
+        }
+
+    case FwJSON::Type::Number:
+        return numberHash(static_cast<const FwJSON::Number*>(this)->value());
+
+    case FwJSON::Type::Bool:
+        return booleanHash(static_cast<const FwJSON::Boolean*>(this)->value());
+
+    case FwJSON::Type::Object:
+        {
+            uint hash = typeHash(FwJSON::Type::Object);
+            foreach(const FwJSON::Attribute& attribute, static_cast<const FwJSON::Object*>(this)->m_attributes)
+            {
+                hash += attributeHash(attribute.hash, attribute.value->hash());
+            }
+            return hash;
+        }
+
+    case FwJSON::Type::Array:
+        {
+            const FwJSON::Array* array = static_cast<const FwJSON::Array*>(this);
+            uint hash = typeHash(FwJSON::Type::Array);
+            foreach(double value, array->m_numbers)
+            {
+                hash = mixHash(hash, numberHash(value));
+            }
+
+            //Rows of a columnar array are hashed as the objects they stand for
+            QVector<uint> nameHashes;
+            foreach(const FwJSON::Column& column, array->m_columns)
+            {
+                nameHashes.append(hashName(column.name.constData(), column.name.size()));
+            }
+            int rows = array->m_columns.isEmpty() ? 0 : array->m_columns.first().present.size();
+            for(int row = 0; row < rows; row++)
+            {
+                uint rowHash = typeHash(FwJSON::Type::Object);
+                for(int i = 0; i < array->m_columns.size(); i++)
+                {
+                    const FwJSON::Column& column = array->m_columns.at(i);
+                    if(column.present.testBit(row))
+                    {
+                        rowHash += attributeHash(nameHashes.at(i), columnHash(column, row));
+                    }
+                }
+                hash = mixHash(hash, rowHash);
+            }
+
+            foreach(const FwJSON::Node* node, array->m_data)
+            {
+                hash = mixHash(hash, node->hash());
+            }
+            return hash;
+        }
+
+    default:
+        return typeHash(type());
+    }
+}
+
+bool FwJSON::Node::equals(const FwJSON::Node* other) const
+{
+    if(this == other)
+    {
+        return true;
+    }
+
+    if(!other || type() != other->type() || hash() != other->hash())
+    {
+        return false;
+    }
+
+    switch(type())
+    {
+    case FwJSON::Type::String:
+        {
+            const FwJSON::String* left = static_cast<const FwJSON::String*>(this);
+            const FwJSON::String* right = static_cast<const FwJSON::String*>(other);
+            return stringValue(left->value(), left->hasEscapes()) == stringValue(right->value(), right->hasEscapes());
+        }
+
+    case FwJSON::Type::Number:
+        return static_cast<const FwJSON::Number*>(this)->value() == static_cast<const FwJSON::Number*>(other)->value();
+
+    case FwJSON::Type::Bool:
+        return static_cast<const FwJSON::Boolean*>(this)->value() == static_cast<const FwJSON::Boolean*>(other)->value();
+
+    case FwJSON::Type::Object:
+        {
+            const FwJSON::Object* left = static_cast<const FwJSON::Object*>(this);
+            const FwJSON::Object* right = static_cast<const FwJSON::Object*>(other);
+            if(left == right)
+            {
+                return true;
+            }
+            if(left->m_attributes.size() != right->m_attributes.size())
+            {
+                return false;
+            }
+            foreach(const FwJSON::Attribute& attribute, left->m_attributes)
+            {
+                int index = right->indexOf(attribute.name.constData(), attribute.name.size(), attribute.hash);
+                if(index < 0 || !attribute.value->equals(right->m_attributes.at(index).value))
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+    case FwJSON::Type::Array:
+        {
+            const FwJSON::Array* left = static_cast<const FwJSON::Array*>(this);
+            const FwJSON::Array* right = static_cast<const FwJSON::Array*>(other);
+            if(left->size() != right->size())
+            {
+                return false;
+            }
+            if(left->isPacked() && right->isPacked())
+            {
+                return left->numbers() == right->numbers();
+            }
+
+            QScopedPointer<FwJSON::Node> leftItem;
+            QScopedPointer<FwJSON::Node> rightItem;
+            for(int i = 0, size = left->size(); i < size; i++)
+            {
+                if(!left->itemView(i, &leftItem)->equals(right->itemView(i, &rightItem)))
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+    default:
+        return true;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+FwJSON::String::String(const QString& value) :
+   BaseClass(),
+   m_offset(0),
+   m_size(0),
+   m_escaped(value.contains(QLatin1Char('\\'))),
+   m_decoded(true),
+   m_value(value)
+{
+}
+
+FwJSON::String::String(const QByteArray& source, int offset, int size, bool escaped) :
+   BaseClass(),
+   m_source(source),
+   m_offset(offset),
+   m_size(size),
+   m_escaped(escaped),
+   m_decoded(false)
+{
+}
+
+FwJSON::String::String(const QByteArray& source, int offset, int size, const QString& value) :
+   BaseClass(),
+   m_source(source),
+   m_offset(offset),
+   m_size(size),
+   m_escaped(false),
+   m_decoded(true),
+   m_value(value)
+{
+}
+
+const QString& FwJSON::String::value() const
+{
+    if(!m_decoded)
+    {
+        m_value = QString::fromUtf8(m_source.constData() + m_offset, m_size);
+        m_decoded = true;
+    }
+    return m_value;
+}
+
+void FwJSON::String::setValue(const QString& value)
+{
+    m_source = QByteArray();
+    m_offset = 0;
+    m_size = 0;
+    m_escaped = value.contains(QLatin1Char('\\'));
+    m_decoded = true;
+    m_value = value;
+    invalidate();
+}
+
+bool FwJSON::String::hasSameText(const FwJSON::String* other) const
+{
+    if(m_escaped != other->m_escaped)
+    {
+        return false;
+    }
+    if(m_source.isNull() || other->m_source.isNull())
+    {
+        return value() == other->value();
+    }
+    return m_size == other->m_size &&
+           memcmp(m_source.constData() + m_offset, other->m_source.constData() + other->m_offset, m_size) == 0;
+}
+
+QByteArray FwJSON::String::utf8() const
+{
+    if(m_source.isNull())
+    {
+        return m_value.toUtf8();
+    }
+    return m_source.mid(m_offset, m_size);
+}
+
+QByteArray FwJSON::String::toUtf8() const
+{
+    if(m_source.isNull())
+    {
+        return "\"" + m_value.toUtf8() + "\"";
+    }
+
+    QByteArray out;
+    out.reserve(m_size + 2);
+    out.append('"');
+    out.append(m_source.constData() + m_offset, m_size);
+    out.append('"');
+    return out;
+}
+
+int FwJSON::String::toInt(bool* bOk) const
+{
+    return value().toInt(bOk);
+}
+
+uint FwJSON::String::toUint(bool* bOk) const
+{
+    if(!value().isEmpty())
+    {
+        if(value().at(0) == '#')
+        {
+            return value().right(value().length() - 1).toUInt(bOk, 16);
+        }
+        return value().toUInt(bOk);
+    }
+    (*bOk) = false;
+    return 0;
+}
+
+bool FwJSON::String::toBool(bool* bOk) const
+{
+    QString lowerValue = value().toLower();
+    if(lowerValue == "true" || lowerValue == "yes")
+    {
+        (*bOk) = true;
+        return true;
+    }
+    (*bOk) = (lowerValue == "false" || lowerValue == "no");
+    return false;
+}
+
+double FwJSON::String::toNumber(bool* bOk) const
+{
+    return value().toDouble(bOk);
+}
+
+QString FwJSON::String::toString(bool* bOk) const
+{
+    if(!m_escaped)
+    {
+        (*bOk) = true;
+        return value();
+    }
+
+    QByteArray utf8 = m_source.isNull() ? m_value.toUtf8() : QByteArray();
+    QByteArray out;
+    bool unescaped = m_source.isNull() ? unescapeUtf8(utf8.constData(), utf8.size(), &out)
+                                       : unescapeUtf8(m_source.constData() + m_offset, m_size, &out);
+    if(!unescaped)
+    {
+        (*bOk) = false;
+        return QString();
+    }
+
+    (*bOk) = true;
+    return QString::fromUtf8(out);
+}
+
+FwJSON::Node* FwJSON::String::clone() const
+{
+    if(m_source.isNull())
+    {
+        return new FwJSON::String(m_value);
+    }
+
+    FwJSON::String* string = new FwJSON::String(m_source, m_offset, m_size, m_escaped);
+    string->m_decoded = m_decoded;
+    string->m_value = m_value;
+    return string;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+FwJSON::Number::Number(double value) :
+    BaseClass(value)
+{
+}
+
+QByteArray FwJSON::Number::toUtf8() const
+{
+    //Packed and columnar numbers are written the same way
+    QByteArray out;
+    FwJSON::Writer(&out).write(value());
+    return out;
+}
+
+int FwJSON::Number::toInt(bool* bOk) const
+{
+    if(qAbs(value()) > 0. && (qAbs(value()) - INT_MAX) < 0.)
+    {
+        if(bOk) { (*bOk) = true; }
+        return static_cast<int>(value());
+    }
+    if(bOk) { (*bOk) = true; }
+    return 0;
+}
+
+uint FwJSON::Number::toUint(bool* bOk) const
+{
+    if(value() > 0. && ((value() - UINT_MAX) < 0.))
+    {
+        if(bOk) { (*bOk) = true; }
+        return static_cast<uint>(value());
+    }
+
+    if(bOk) { (*bOk) = false; }
+    return 0;
+}
+
+bool FwJSON::Number::toBool(bool* bOk) const
+{
+    if(bOk) { (*bOk) = true; }
+    return qFuzzyCompare(value(), 0.);
+}
+
+double FwJSON::Number::toNumber(bool* bOk) const
+{
+    if(bOk) { (*bOk) = true; }
+    return value();
+}
+
+QString FwJSON::Number::toString(bool* bOk) const
+{
+    if(bOk) { (*bOk) = true; }
+    return QString::number(value());
+}
+
+FwJSON::Node* FwJSON::Number::clone() const
+{
+    return new FwJSON::Number(value());
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+FwJSON::Boolean::Boolean(bool value) :
+    BaseClass(value)
+{
+}
+
+QByteArray FwJSON::Boolean::toUtf8() const
+{
+    return value() ? FwJSON::constantTrue : FwJSON::constantFalse;
+}
+
+int FwJSON::Boolean::toInt(bool* bOk) const
+{
+    (*bOk) = true;
+    return value();
+}
+
+uint FwJSON::Boolean::toUint(bool* bOk) const
+{
+    (*bOk) = true;
+    return value();
+}
+
+bool FwJSON::Boolean::toBool(bool* bOk) const
+{
+    (*bOk) = true;
+    return value();
+}
+
+double FwJSON::Boolean::toNumber(bool* bOk) const
+{
+    (*bOk) = true;
+    return value();
+}
+
+QString FwJSON::Boolean::toString(bool* bOk) const
+{
+    (*bOk) = true;
+    return boolToName(value());
+}
+
+FwJSON::Node* FwJSON::Boolean::clone() const
+{
+    return new FwJSON::Boolean(value());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+FwJSON::Null::Null() :
+    BaseClass()
+{
+}
+
+QByteArray FwJSON::Null::toUtf8() const
+{
+    return FwJSON::constantNull;
+}
+
+int FwJSON::Null::toInt(bool* bOk) const
+{
+    if(bOk) { (*bOk) = false; }
+    return 0;
+}
+
+uint FwJSON::Null::toUint(bool* bOk) const
+{
+    if(bOk) { (*bOk) = false; }
+    return 0;
+}
+
+bool FwJSON::Null::toBool(bool* bOk) const
+{
+    if(bOk) { (*bOk) = false; }
+    return false;
+}
+
+double FwJSON::Null::toNumber(bool* bOk) const
+{
+    if(bOk) { (*bOk) = false; }
+    return 0.;
+}
+
+QString FwJSON::Null::toString(bool* bOk) const
+{
+    if(bOk) { (*bOk) = false; }
+    return QString();
+}
+
+FwJSON::Node* FwJSON::Null::clone() const
+{
+    return new FwJSON::Null();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+FwJSON::Object::Object() :
+    BaseClass(),
+    m_shared(false),
+    m_utf8Cached(false),
+    m_utf8Offset(0),
+    m_utf8Size(0)
+{
+}
+
+FwJSON::Object::~Object()
+{
+    //A frozen tree may be destroyed
+    frozen_ = false;
+    clear();
+}
+
+int FwJSON::Object::indexOf(const char* name, int size, uint hash) const
+{
+    const FwJSON::Attribute* attributes = m_attributes.constData();
+    if(m_index.isEmpty())
+    {
+        for(int i = 0, count = m_attributes.size(); i < count; i++)
+        {
+            const FwJSON::Attribute& attribute = attributes[i];
+            if(attribute.hash == hash && attribute.name.size() == size && memcmp(attribute.name.constData(), name, size) == 0)
+            {
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    const int* slots = m_index.constData();
+    int mask = m_index.size() - 1;
+    for(int slot = hash & mask; slots[slot] >= 0; slot = (slot + 1) & mask)
+    {
+        const FwJSON::Attribute& attribute = attributes[slots[slot]];
+        if(attribute.hash == hash && attribute.name.size() == size && memcmp(attribute.name.constData(), name, size) == 0)
+        {
+            return slots[slot];
+        }
+    }
+    return -1;
+}
+
+int FwJSON::Object::indexOf(const FwJSON::Node* value) const
+{
+    for(int i = 0, count = m_attributes.size(); i < count; i++)
+    {
+        if(m_attributes.at(i).value == value)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void FwJSON::Object::insertAttribute(const QByteArray& name, uint hash, FwJSON::Node* value)
+{
+    FwJSON::Attribute attribute = { name, value, hash };
+    m_attributes.append(attribute);
+    if(m_attributes.size() * 2 > m_index.size())
+    {
+        updateIndex();
+    }
+    else
+    {
+        insertIndex(m_attributes.size() - 1);
+    }
+}
+
+void FwJSON::Object::removeAttributeAt(int index)
+{
+    m_attributes.remove(index);
+    updateIndex();
+    invalidate();
+}
+
+void FwJSON::Object::insertIndex(int index)
+{
+    int* slots = m_index.data();
+    int mask = m_index.size() - 1;
+    int slot = m_attributes.at(index).hash & mask;
+    while(slots[slot] >= 0)
+    {
+        slot = (slot + 1) & mask;
+    }
+    slots[slot] = index;
+}
+
+void FwJSON::Object::updateIndex()
+{
+    //Linear search is faster for small objects
+    if(m_attributes.size() <= 8)
+    {
+        m_index.clear();
+        return;
+    }
+
+    int capacity = 32;
+    while(capacity < m_attributes.size() * 4)
+    {
+        capacity <<= 1;
+    }
+    m_index.fill(-1, capacity);
+    for(int i = 0; i < m_attributes.size(); i++)
+    {
+        insertIndex(i);
+    }
+}
+
+void FwJSON::Object::clear()
+{
+    //Shared children belong to the frozen object
+    if(!m_shared)
+    {
+        foreach(const FwJSON::Attribute& attribute, m_attributes)
+        {
+            Q_ASSERT(attribute.value->parent_ == this);
+            attribute.value->parent_ = nullptr;
+            delete attribute.value;
+        }
+    }
+    m_shared = false;
+    m_attributes.clear();
+    m_index.clear();
+    invalidate();
+}
+
+void FwJSON::Object::swap(FwJSON::Object& other)
+{
+    m_attributes.swap(other.m_attributes);
+    m_index.swap(other.m_index);
+    qSwap(m_shared, other.m_shared);
+    foreach(const FwJSON::Attribute& attribute, m_attributes)
+    {
+        if(!m_shared)
+        {
+            attribute.value->parent_ = this;
+        }
+    }
+    foreach(const FwJSON::Attribute& attribute, other.m_attributes)
+    {
+        if(!other.m_shared)
+        {
+            attribute.value->parent_ = &other;
+        }
+    }
+    invalidate();
+    other.invalidate();
+}
+
+FwJSON::Node* FwJSON::Object::addAttribute(const QByteArray& name, FwJSON::Node* value, bool replace)
+{
+    return addAttribute(name, hashName(name.constData(), name.size()), value, replace);
+}
+
+FwJSON::Node* FwJSON::Object::addAttribute(const QByteArray& name, uint hash, FwJSON::Node* value, bool replace)
+{
+    detach();
+    if (value->parent_)
+    {
+        if  (value->parent_ == this)
+        {
+            return value;
+        }
+        value->takeFromParent();
+    }
+
+    int index = indexOf(name.constData(), name.size(), hash);
+    if (index >= 0)
+    {
+        FwJSON::Node* currentAttr = m_attributes.at(index).value;
+        if(replace)
+        {
+            currentAttr->parent_ = nullptr;
+            delete currentAttr;
+
+            value->parent_ = this;
+            m_attributes[index].value = value;
+            invalidate();
+            return value;
+        }
+        else
+        {
+            FwJSON::Array* addArray = cast<FwJSON::Array>(currentAttr);
+            if(!addArray)
+            {
+                currentAttr->takeFromParent();
+                addArray = this->addArray(name);
+                addArray->addValue(currentAttr);
+            }
+            return addArray->addValue(value);
+        }
+    }
+
+    value->parent_ = this;
+    insertAttribute(name, hash, value);
+    invalidate();
+    return value;
+}
+
+FwJSON::Node* FwJSON::Object::addParsedAttribute(const QByteArray& name, uint hash, FwJSON::Node* value)
+{
+    Q_ASSERT(!value->parent_ && !m_shared);
+    value->parent_ = this;
+    int index = indexOf(name.constData(), name.size(), hash);
+    if(index >= 0)
+    {
+        //The last value of a repeated name is kept, see addAttribute()
+        FwJSON::Node* currentAttr = m_attributes.at(index).value;
+        currentAttr->parent_ = nullptr;
+        delete currentAttr;
+        m_attributes[index].value = value;
+        return value;
+    }
+
+    insertAttribute(name, hash, value);
+    return value;
+}
+
+QByteArray FwJSON::Object::toUtf8() const
+{
+    //The form of the top-level object is the whole shared buffer
+    if(!utf8_.isNull())
+    {
+        return m_utf8Offset == 0 && m_utf8Size == utf8_.size() ? utf8_ : utf8_.mid(m_utf8Offset, m_utf8Size);
+    }
+
+    QByteArray utf8;
+    FwJSON::Writer writer(&utf8);
+    write(&writer);
+    return utf8;
+}
+
+void FwJSON::Object::setUtf8Cached(bool cached)
+{
+    m_utf8Cached = cached;
+    if(!cached && !frozen_)
+    {
+        //The forms of the ancestors hold this one, they are reset too
+        clearUtf8Cache(this);
+        invalidate();
+    }
+}
+
+void FwJSON::Object::serialize(FwJSON::Writer* writer, QVector<Utf8Range>* cached) const
+{
+    //Ranges are made cached forms by FwJSON::Node::write() once the
+    //whole output is written
+    int begin = cached ? writer->buffer()->size() : 0;
+
+    writer->writeRaw('{');
+    bool first = true;
+    foreach(const FwJSON::Attribute& attribute, m_attributes)
+    {
+        if(isEmptyUtf8(attribute.value))
+        {
+            continue;
+        }
+
+        if(!first)
+        {
+            writer->writeRaw(',');
+        }
+        first = false;
+        writer->writeRaw('"');
+        writer->writeRaw(attribute.name.constData(), attribute.name.size());
+        writer->writeRaw("\":", 2);
+        writeUtf8(attribute.value, writer, cached);
     }
-}
+    writer->writeRaw('}');
 
-////////////////////////////////////////////////////////////////////////////////
+    if(cached)
+    {
+        Utf8Range range = { this, begin, writer->buffer()->size() - begin };
+        cached->append(range);
+    }
+}
 
-FwJSON::String::String(const QString& value) :
-   BaseClass(value)
+void FwJSON::Object::parse(const QByteArray& utf8String, FwJSON::ParseOptions options)
 {
+    FwJSON::Parser(options).parse(utf8String, this);
 }
 
-QByteArray FwJSON::String::toUtf8() const
+void FwJSON::Object::parse(QIODevice* ioDevice, FwJSON::ParseOptions options)
 {
-    return "\"" + value().toUtf8() + "\"";
+    FwJSON::Parser(options).parse(ioDevice, this);
 }
 
-int FwJSON::String::toInt(bool* bOk) const
+void FwJSON::Object::reparse(const QByteArray& utf8String, FwJSON::ParseOptions options, QVector<FwJSON::Node*>* changed)
 {
-    return value().toInt(bOk);
+    //The walk cannot fail on a checked document, other input goes
+    //through the parser, so either way a malformed one changes nothing
+    if(isStrict(utf8String))
+    {
+        FwJSON::Reader reader(utf8String);
+        update(&reader, this, options, changed);
+        return;
+    }
+
+    FwJSON::Object source;
+    source.parse(utf8String, options);
+    update(this, &source, changed);
 }
 
-uint FwJSON::String::toUint(bool* bOk) const
+void FwJSON::Object::parseFile(const QString& fileName, FwJSON::ParseOptions options)
 {
-    if(!value().isEmpty())
+    QFile file(QDir::toNativeSeparators(fileName));
+    if(!file.open(QIODevice::ReadOnly | QIODevice::Text))
     {
-        if(value().at(0) == '#')
-        {
-            return value().right(value().length() - 1).toUInt(bOk, 16);
-        }
-        return value().toUInt(bOk);
+        throw FwJSON::Exception(file);
     }
+    parse(&file, options);
+}
+
+int FwJSON::Object::toInt(bool* bOk) const
+{
     (*bOk) = false;
     return 0;
 }
 
-bool FwJSON::String::toBool(bool* bOk) const
+uint FwJSON::Object::toUint(bool* bOk) const
 {
-    QString lowerValue = value().toLower();
-    if(lowerValue == "true" || lowerValue == "yes")
-    {
-        (*bOk) = true;
-        return true;
-    }
-    (*bOk) = (lowerValue == "false" || lowerValue == "no");
-    return false;
+    (*bOk) = false;
+    return 0;
 }
 
-double FwJSON::String::toNumber(bool* bOk) const
+bool FwJSON::Object::toBool(bool* bOk) const
 {
-    return value().toDouble(bOk);
+    (*bOk) = false;
+    return false;
 }
 
-QString FwJSON::String::toString(bool* bOk) const
+double FwJSON::Object::toNumber(bool* bOk) const
 {
-    QString value = this->value();
+    (*bOk) = false;
+    return 0.;
+}
 
-    QString out;
-    out.reserve(value.size());
+QString FwJSON::Object::toString(bool* bOk) const
+{
+    (*bOk) = false;
+    return QString();
+}
 
-    QString::ConstIterator iter = value.begin();
-    QString::ConstIterator end = value.end();
-    try
+void FwJSON::Object::mergePatch(const FwJSON::Object& patch)
+{
+    if(&patch == this)
     {
-        while(iter != end)
-        {
+        return;
+    }
 
-            if(*iter != QChar('\\'))
-            {
-                out.append(*iter);
-                ++iter;
-                continue;
-            }
+    detach();
 
-            if((++iter) == end)
-            {
-                throw FwJSON::Exception();
-            }
+    for(const FwJSON::Attribute& attribute : patch)
+    {
+        mergeAttribute(attribute, nullptr);
+    }
+}
 
-            switch(iter->unicode())
-            {
-            case '"':
-            case '\\':
-            case '/':
-            case 'b':
-            case 'f':
-            case 'n':
-            case 'r':
-            case 't':
-                out.append(QChar(iter->unicode()));
-                break;
+void FwJSON::Object::mergePatch(FwJSON::Object&& patch)
+{
+    if(&patch == this)
+    {
+        return;
+    }
 
-            case 'u':
-                if((end - iter) >= 5)
-                {
-                    bool ok = false;
-                    short uch = QString(iter+1, 4).toShort(&ok, 16);
-                    if(!ok)
-                    {
-                        throw FwJSON::Exception();
-                    }
+    //Only own values can be moved
+    detach();
+    patch.detach();
 
-                    out.append(QChar(uch));
+    foreach(const FwJSON::Attribute& attribute, patch.m_attributes)
+    {
+        mergeAttribute(attribute, &patch);
+    }
 
-                    iter += 5;
-                    continue;
-                }
-                break;
+    //Moved values have the new parent already
+    foreach(const FwJSON::Attribute& attribute, patch.m_attributes)
+    {
+        if(attribute.value->parent_ == &patch)
+        {
+            attribute.value->parent_ = nullptr;
+            delete attribute.value;
+        }
+    }
+    patch.m_attributes.clear();
+    patch.m_index.clear();
+    patch.invalidate();
+}
 
-            default:
-                throw FwJSON::Exception();
-            }
+void FwJSON::Object::mergeAttribute(const FwJSON::Attribute& attribute, FwJSON::Object* source)
+{
+    int index = indexOf(attribute.name.constData(), attribute.name.size(), attribute.hash);
+    FwJSON::Node* current = index < 0 ? nullptr : m_attributes.at(index).value;
 
-            ++iter;
+    if(attribute.value->isNull())
+    {
+        if(current)
+        {
+            removeAttributeAt(index);
+            current->parent_ = nullptr;
+            delete current;
         }
+        return;
     }
-    catch(const FwJSON::Exception& e)
+
+    FwJSON::Node* value = nullptr;
+    if(FwJSON::Object* patch = cast<FwJSON::Object>(attribute.value))
     {
-        (*bOk) = false;
-        return QString();
-    }
+        if(FwJSON::Object* object = cast<FwJSON::Object>(current))
+        {
+            source ? object->mergePatch(std::move(*patch)) : object->mergePatch(*patch);
+            return;
+        }
 
-    (*bOk) = true;
-    return out;
-}
+        //Null attributes are removed from the patch as well
+        FwJSON::Object* object = new FwJSON::Object();
+        source ? object->mergePatch(std::move(*patch)) : object->mergePatch(*patch);
+        value = object;
+    }
+    else
+    {
+        value = source ? attribute.value : attribute.value->clone();
+    }
 
-FwJSON::Node* FwJSON::String::clone() const
-{
-    return new FwJSON::String(value());
+    value->parent_ = this;
+    if(current)
+    {
+        current->parent_ = nullptr;
+        delete current;
+        m_attributes[index].value = value;
+        invalidate();
+    }
+    else
+    {
+        insertAttribute(attribute.name, attribute.hash, value);
+        invalidate();
+    }
 }
 
-////////////////////////////////////////////////////////////////////////////////
-
-FwJSON::Number::Number(double value) :
-    BaseClass(value)
+FwJSON::Node* FwJSON::Object::clone() const
 {
-}
+    //Names and the index are implicitly shared with this object
+    FwJSON::Object* newObject = new FwJSON::Object();
+    if(frozen_ || m_shared)
+    {
+        newObject->m_attributes = m_attributes;
+        newObject->m_index = m_index;
+        newObject->m_shared = true;
+        newObject->hash_ = hash_;
+        newObject->hashed_ = hashed_;
+        return newObject;
+    }
 
-QByteArray FwJSON::Number::toUtf8() const
-{
-    return QByteArray::number(value());
+    newObject->m_attributes.reserve(m_attributes.size());
+    foreach(FwJSON::Attribute attribute, m_attributes)
+    {
+        attribute.value = attribute.value->clone();
+        attribute.value->parent_ = newObject;
+        newObject->m_attributes.append(attribute);
+    }
+    newObject->m_index = m_index;
+    return newObject;
 }
 
-int FwJSON::Number::toInt(bool* bOk) const
+void FwJSON::Object::copySharedChildren()
 {
-    if(qAbs(value()) > 0. && (qAbs(value()) - INT_MAX) < 0.)
+    //The copies of frozen objects and arrays share the next level
+    FwJSON::Attribute* attributes = m_attributes.data();
+    for(int i = 0, count = m_attributes.size(); i < count; i++)
     {
-        if(bOk) { (*bOk) = true; }
-        return static_cast<int>(value());
+        attributes[i].value = attributes[i].value->clone();
+        attributes[i].value->parent_ = this;
     }
-    if(bOk) { (*bOk) = true; }
-    return 0;
+    m_shared = false;
 }
 
-uint FwJSON::Number::toUint(bool* bOk) const
+////////////////////////////////////////////////////////////////////////////////
+
+namespace
 {
-    if(value() > 0. && ((value() - UINT_MAX) < 0.))
+    FwJSON::Statistics numbersStatistics(const double* values, int size)
     {
-        if(bOk) { (*bOk) = true; }
-        return static_cast<uint>(value());
-    }
+        FwJSON::Statistics statistics;
+        if(size <= 0)
+        {
+            return statistics;
+        }
 
-    if(bOk) { (*bOk) = false; }
-    return 0;
-}
+        double sum = 0.;
+        double min = values[0];
+        double max = values[0];
+        int i = 0;
 
-bool FwJSON::Number::toBool(bool* bOk) const
-{
-    if(bOk) { (*bOk) = true; }
-    return qFuzzyCompare(value(), 0.);
+#if defined(__SSE2__)
+        if(size >= 4)
+        {
+            //Two lanes per register, two registers per step
+            __m128d sum0 = _mm_setzero_pd();
+            __m128d sum1 = _mm_setzero_pd();
+            __m128d min0 = _mm_set1_pd(values[0]);
+            __m128d min1 = min0;
+            __m128d max0 = min0;
+            __m128d max1 = min0;
+            for(; i + 4 <= size; i += 4)
+            {
+                __m128d a = _mm_loadu_pd(values + i);
+                __m128d b = _mm_loadu_pd(values + i + 2);
+                sum0 = _mm_add_pd(sum0, a);
+                sum1 = _mm_add_pd(sum1, b);
+                min0 = _mm_min_pd(min0, a);
+                min1 = _mm_min_pd(min1, b);
+                max0 = _mm_max_pd(max0, a);
+                max1 = _mm_max_pd(max1, b);
+            }
+
+            double lanes[2];
+            _mm_storeu_pd(lanes, _mm_add_pd(sum0, sum1));
+            sum = lanes[0] + lanes[1];
+            _mm_storeu_pd(lanes, _mm_min_pd(min0, min1));
+            min = qMin(lanes[0], lanes[1]);
+            _mm_storeu_pd(lanes, _mm_max_pd(max0, max1));
+            max = qMax(lanes[0], lanes[1]);
+        }
+#else
+        //Independent sums let the compiler pipeline the additions
+        double sum1 = 0.;
+        double sum2 = 0.;
+        double sum3 = 0.;
+        for(; i + 4 <= size; i += 4)
+        {
+            sum += values[i];
+            sum1 += values[i + 1];
+            sum2 += values[i + 2];
+            sum3 += values[i + 3];
+            min = qMin(qMin(min, values[i]), qMin(values[i + 1], qMin(values[i + 2], values[i + 3])));
+            max = qMax(qMax(max, values[i]), qMax(values[i + 1], qMax(values[i + 2], values[i + 3])));
+        }
+        sum += (sum1 + sum2) + sum3;
+#endif
+
+        for(; i < size; i++)
+        {
+            sum += values[i];
+            min = qMin(min, values[i]);
+            max = qMax(max, values[i]);
+        }
+
+        statistics.count = size;
+        statistics.sum = sum;
+        statistics.min = min;
+        statistics.max = max;
+        return statistics;
+    }
 }
 
-double FwJSON::Number::toNumber(bool* bOk) const
+FwJSON::Array::Array() :
+    BaseClass(),
+    m_packed(false),
+    m_shared(false),
+    m_utf8Cached(false),
+    m_utf8Offset(0),
+    m_utf8Size(0)
 {
-    if(bOk) { (*bOk) = true; }
-    return value();
 }
 
-QString FwJSON::Number::toString(bool* bOk) const
+FwJSON::Array::~Array()
 {
-    if(bOk) { (*bOk) = true; }
-    return QString::number(value());
+    //A frozen tree may be destroyed
+    frozen_ = false;
+    clear();
 }
 
-FwJSON::Node* FwJSON::Number::clone() const
+void FwJSON::Array::materialize() const
 {
-    return new FwJSON::Number(value());
-}
+    m_data.reserve(size());
+    foreach(double value, m_numbers)
+    {
+        FwJSON::Node* node = new FwJSON::Number(value);
+        node->parent_ = const_cast<FwJSON::Array*>(this);
+        m_data.append(node);
+    }
+    m_numbers = QVector<double>();
+    m_packed = false;
 
-///////////////////////////////////////////////////////////////////////////////
+    int rows = m_columns.isEmpty() ? 0 : m_columns.first().present.size();
+    for(int index = 0; index < rows; index++)
+    {
+        FwJSON::Object* object = row(index);
+        object->parent_ = const_cast<FwJSON::Array*>(this);
+        m_data.append(object);
+    }
+    m_columns = QVector<FwJSON::Column>();
 
-FwJSON::Boolean::Boolean(bool value) :
-    BaseClass(value)
-{
+    //The new nodes have nothing cached, the ancestors must not keep
+    //anything either, see FwJSON::Node::invalidate()
+    const_cast<FwJSON::Array*>(this)->invalidate();
 }
 
-QByteArray FwJSON::Boolean::toUtf8() const
+FwJSON::Object* FwJSON::Array::row(int index) const
 {
-    return value() ? FwJSON::constantTrue : FwJSON::constantFalse;
-}
+    FwJSON::Object* object = new FwJSON::Object();
+    foreach(const FwJSON::Column& column, m_columns)
+    {
+        if(!column.present.testBit(index))
+        {
+            continue;
+        }
 
-int FwJSON::Boolean::toInt(bool* bOk) const
-{
-    (*bOk) = true;
-    return value();
+        switch(column.type)
+        {
+        case FwJSON::Type::Number:
+            object->addNumber(column.name, column.numbers.at(index));
+            break;
+
+        case FwJSON::Type::Bool:
+            object->addBoolean(column.name, column.flags.testBit(index));
+            break;
+
+        case FwJSON::Type::String:
+            {
+                const QString& value = column.strings.at(index);
+                QByteArray text;
+                if(!column.flags.testBit(index) && escapeUtf8(value, &text))
+                {
+                    object->addAttribute(column.name, new FwJSON::String(text, 0, text.size(), value));
+                }
+                else
+                {
+                    object->addString(column.name, value);
+                }
+            }
+            break;
+
+        default:
+            Q_ASSERT(false);
+            break;
+        }
+    }
+    return object;
 }
 
-uint FwJSON::Boolean::toUint(bool* bOk) const
+const FwJSON::Node* FwJSON::Array::itemView(int index, QScopedPointer<FwJSON::Node>* temporary) const
 {
-    (*bOk) = true;
-    return value();
+    if(index < 0 || index >= size())
+    {
+        return nullptr;
+    }
+
+    if(m_packed)
+    {
+        FwJSON::Number* number = cast<FwJSON::Number>(temporary->data());
+        if(!number)
+        {
+            number = new FwJSON::Number();
+            temporary->reset(number);
+        }
+        number->setValue(m_numbers.at(index));
+        return number;
+    }
+    if(!m_columns.isEmpty())
+    {
+        temporary->reset(row(index));
+        return temporary->data();
+    }
+    return m_data.at(index);
 }
 
-bool FwJSON::Boolean::toBool(bool* bOk) const
+bool FwJSON::Array::toColumnar()
 {
-    (*bOk) = true;
-    return value();
-}
+    if(!m_columns.isEmpty())
+    {
+        return true;
+    }
+
+    if(m_packed || m_data.isEmpty())
+    {
+        return false;
+    }
+
+    int rows = m_data.size();
+    QVector<FwJSON::Column> columns;
+    QHash<QByteArray, int> columnIndexes;
+    QHash<QString, QString> strings;
+    for(int row = 0; row < rows; row++)
+    {
+        const FwJSON::Object* object = cast<FwJSON::Object>(m_data.at(row));
+        if(!object)
+        {
+            return false;
+        }
+
+        for(const FwJSON::Attribute& attribute : *object)
+        {
+            FwJSON::Type type = attribute.value->type();
+            int index = columnIndexes.value(attribute.name, -1);
+            if(index < 0)
+            {
+                if(type != FwJSON::Type::String && type != FwJSON::Type::Number && type != FwJSON::Type::Bool)
+                {
+                    return false;
+                }
+
+                index = columns.size();
+                columnIndexes.insert(attribute.name, index);
+
+                FwJSON::Column column;
+                column.name = attribute.name;
+                column.type = type;
+                column.present = QBitArray(rows);
+                if(type == FwJSON::Type::Number)
+                {
+                    column.numbers.resize(rows);
+                }
+                else
+                {
+                    column.flags = QBitArray(rows);
+                }
+                if(type == FwJSON::Type::String)
+                {
+                    column.strings.resize(rows);
+                }
+                columns.append(column);
+            }
+
+            FwJSON::Column& column = columns[index];
+            if(column.type != type)
+            {
+                return false;
+            }
+
+            column.present.setBit(row);
+            switch(type)
+            {
+            case FwJSON::Type::Number:
+                column.numbers[row] = static_cast<const FwJSON::Number*>(attribute.value)->value();
+                break;
 
-double FwJSON::Boolean::toNumber(bool* bOk) const
-{
-    (*bOk) = true;
-    return value();
-}
+            case FwJSON::Type::Bool:
+                column.flags.setBit(row, static_cast<const FwJSON::Boolean*>(attribute.value)->value());
+                break;
 
-QString FwJSON::Boolean::toString(bool* bOk) const
-{
-    (*bOk) = true;
-    return boolToName(value());
-}
+            case FwJSON::Type::String:
+                {
+                    const FwJSON::String* string = static_cast<const FwJSON::String*>(attribute.value);
+                    QString& value = strings[string->value()];
+                    if(value.isNull())
+                    {
+                        value = string->value();
+                    }
+                    column.strings[row] = value;
+                    column.flags.setBit(row, string->hasEscapes());
+                }
+                break;
 
-FwJSON::Node* FwJSON::Boolean::clone() const
-{
-    return new FwJSON::Boolean(value());
-}
+            default:
+                break;
+            }
+        }
+    }
 
-////////////////////////////////////////////////////////////////////////////////
+    if(columns.isEmpty())
+    {
+        return false;
+    }
 
-FwJSON::Object::Object() :
-    BaseClass()
-{
+    //Shared items belong to the frozen array
+    if(!m_shared)
+    {
+        foreach(FwJSON::Node* node, m_data)
+        {
+            node->parent_ = nullptr;
+            delete node;
+        }
+    }
+    m_shared = false;
+    m_data.clear();
+    m_columns.swap(columns);
+    return true;
 }
 
-FwJSON::Object::~Object()
+const FwJSON::Column* FwJSON::Array::column(const QByteArray& name) const
 {
-    clear();
+    const QVector<FwJSON::Column>& columns = m_columns;
+    for(const FwJSON::Column& column : columns)
+    {
+        if(column.name == name)
+        {
+            return &column;
+        }
+    }
+    return nullptr;
 }
 
-void FwJSON::Object::clear()
+FwJSON::Statistics FwJSON::Array::statistics() const
 {
-    foreach(FwJSON::Node* node, m_attributes.values())
+    const FwJSON::Array* array = this;
+    if(array->m_packed)
     {
-        Q_ASSERT(node->parent_ == this);
-        node->parent_ = nullptr;
-        delete node;
+        return numbersStatistics(array->m_numbers.constData(), array->m_numbers.size());
     }
-    m_attributes.clear();
-}
 
-FwJSON::Node* FwJSON::Object::addAttribute(const QByteArray& name, FwJSON::Node* value, bool replace)
-{
-    if (value->parent_)
+    FwJSON::Statistics statistics;
+    foreach(const FwJSON::Node* node, array->m_data)
     {
-        if  (value->parent_ == this)
+        if(node->type() == FwJSON::Type::Number)
         {
-            return value;
+            statistics.add(static_cast<const FwJSON::Number*>(node)->value());
         }
-        value->takeFromParent();
     }
+    return statistics;
+}
 
-    FwJSON::Node* currentAttr = m_attributes.value(name);
-    if (currentAttr)
+FwJSON::Statistics FwJSON::Array::statistics(const QByteArray& name) const
+{
+    FwJSON::Statistics statistics;
+    if(const FwJSON::Column* column = this->column(name))
     {
-        if(replace)
+        if(column->type != FwJSON::Type::Number)
         {
-            delete currentAttr;
+            return statistics;
         }
-        else
+
+        int rows = column->present.size();
+        if(column->present.count(true) == rows)
         {
-            FwJSON::Array* addArray = cast<FwJSON::Array>(currentAttr);
-            if(!addArray)
+            return numbersStatistics(column->numbers.constData(), rows);
+        }
+
+        for(int row = 0; row < rows; row++)
+        {
+            if(column->present.testBit(row))
             {
-                addArray = this->addArray(name);
-                addArray->addValue(currentAttr);
+                statistics.add(column->numbers.at(row));
             }
-            return addArray->addValue(value);
         }
+        return statistics;
     }
 
-    value->parent_ = this;
-    m_attributes.insert(name, value);
-    return value;
-}
-
-QByteArray FwJSON::Object::toUtf8() const
-{
-    QByteArray attributes;
-    for(QHash<QByteArray, FwJSON::Node*>::const_iterator iter = m_attributes.begin(); iter != m_attributes.end(); ++iter)
+    FwJSON::Key key(name.constData(), name.size());
+    double value = 0.;
+    foreach(FwJSON::Node* node, m_data)
     {
-        QByteArray value = iter.value()->toUtf8();
-        if(!value.isEmpty())
+        FwJSON::Object* object = cast<FwJSON::Object>(node);
+        if(object && object->hasValue<FwJSON::Number>(key, &value))
         {
-            if(!attributes.isEmpty())
-            {
-               attributes += ",";
-            }
-            attributes += ("\"" + iter.key() + "\"");
-            attributes += ":";
-            attributes += value;
+            statistics.add(value);
         }
-
     }
-    return "{" + attributes + "}";
+    return statistics;
 }
 
-void FwJSON::Object::parse(const QByteArray& utf8String)
+QVector<int> FwJSON::Array::histogram(double min, double max, int bins) const
 {
-    if(utf8String.isEmpty())
+    FwJSON::Histogram histogram(min, max, bins);
+    const FwJSON::Array* array = this;
+    foreach(double value, array->m_numbers)
     {
-        throw FwJSON::Exception("Input string is empty");
+        histogram.add(value);
     }
-    QByteArray tmpStr = utf8String;
-    QBuffer buffer(&tmpStr);
-    parse(&buffer);
-}
-
-void FwJSON::Object::parse(QIODevice* ioDevice)
-{
-    try
+    foreach(const FwJSON::Node* node, array->m_data)
     {
-        if(!ioDevice->isOpen() && !ioDevice->open(QIODevice::ReadOnly | QIODevice::Text))
+        if(node->type() == FwJSON::Type::Number)
         {
-            throw FwJSON::Exception(ioDevice->errorString());
+            histogram.add(static_cast<const FwJSON::Number*>(node)->value());
         }
+    }
+    return histogram.bins;
+}
 
-        ParseData data;
-        data.parent = this;
-        while(!ioDevice->atEnd())
+QVector<int> FwJSON::Array::histogram(const QByteArray& name, double min, double max, int bins) const
+{
+    FwJSON::Histogram histogram(min, max, bins);
+    if(const FwJSON::Column* column = this->column(name))
+    {
+        if(column->type == FwJSON::Type::Number)
         {
-            data.line++;
-            data.column = 0;
-            QByteArray line = ioDevice->readLine().trimmed();
-            if(!line.isEmpty())
+            for(int row = 0; row < column->present.size(); row++)
             {
-                int line_size = line.size();
-                char* c_ptr = line.data();
-                for(;data.column < line_size; data.column++, c_ptr++)
+                if(column->present.testBit(row))
                 {
-                    quint8 nextChar = static_cast<quint8>(*c_ptr);
-
-                    CharType charType = nextChar > 0 ? chars_type[nextChar] : C_Uni;
-                    if(CommandFunc cmd = parse_commands[data.xcmd][charType])
-                    {
-                        cmd((*c_ptr), &data);
-                    }
-                    else
-                    {
-                        data.buffer += (*c_ptr);
-                    }
+                    histogram.add(column->numbers.at(row));
                 }
             }
         }
+        return histogram.bins;
+    }
 
-        if(!data.buffer.isEmpty())
+    FwJSON::Key key(name.constData(), name.size());
+    double value = 0.;
+    foreach(FwJSON::Node* node, m_data)
+    {
+        FwJSON::Object* object = cast<FwJSON::Object>(node);
+        if(object && object->hasValue<FwJSON::Number>(key, &value))
         {
-            data.setupValue();
+            histogram.add(value);
         }
-
-    }
-    catch(const FwJSON::Exception& e)
-    {
-        clear();
-        throw e;
     }
+    return histogram.bins;
 }
 
-void FwJSON::Object::parseFile(const QString& fileName)
+bool FwJSON::Array::pack()
 {
-    QFile file(QDir::toNativeSeparators(fileName));
-    if(!file.open(QIODevice::ReadOnly | QIODevice::Text))
+    if(m_packed)
     {
-        throw FwJSON::Exception(file);
+        return true;
     }
-    parse(&file);
-}
 
-int FwJSON::Object::toInt(bool* bOk) const
-{
-    (*bOk) = false;
-    return 0;
-}
+    if(m_data.isEmpty())
+    {
+        return false;
+    }
 
-uint FwJSON::Object::toUint(bool* bOk) const
-{
-    (*bOk) = false;
-    return 0;
-}
+    foreach(FwJSON::Node* node, m_data)
+    {
+        if(node->type() != FwJSON::Type::Number)
+        {
+            return false;
+        }
+    }
 
-bool FwJSON::Object::toBool(bool* bOk) const
-{
-    (*bOk) = false;
-    return false;
+    //See toColumnar()
+    m_numbers.reserve(m_data.size());
+    foreach(FwJSON::Node* node, m_data)
+    {
+        m_numbers.append(static_cast<FwJSON::Number*>(node)->value());
+        if(!m_shared)
+        {
+            node->parent_ = nullptr;
+            delete node;
+        }
+    }
+    m_shared = false;
+    m_data.clear();
+    m_packed = true;
+    return true;
 }
 
-double FwJSON::Object::toNumber(bool* bOk) const
+void FwJSON::Array::appendNumber(double value)
 {
-    (*bOk) = false;
-    return 0.;
+    detach();
+    if(m_packed || m_data.isEmpty())
+    {
+        m_packed = true;
+        m_numbers.append(value);
+        invalidate();
+    }
+    else
+    {
+        addNumber(value);
+    }
 }
 
-QString FwJSON::Object::toString(bool* bOk) const
+void FwJSON::Array::clear()
 {
-    (*bOk) = false;
-    return QString();
+    //See FwJSON::Object::clear()
+    if(!m_shared)
+    {
+        foreach(FwJSON::Node* node, m_data)
+        {
+            Q_ASSERT(node->parent_ == this);
+            node->parent_ = nullptr;
+            delete node;
+        }
+    }
+    m_shared = false;
+    m_data.clear();
+    m_numbers.clear();
+    m_packed = false;
+    m_columns.clear();
+    invalidate();
 }
 
-FwJSON::Node* FwJSON::Object::clone() const
+void FwJSON::Array::swap(FwJSON::Array& other)
 {
-    FwJSON::Object* newObject = new FwJSON::Object();
-    for(QHash<QByteArray, FwJSON::Node*>::const_iterator iter = m_attributes.begin(); iter != m_attributes.end(); ++iter)
+    m_data.swap(other.m_data);
+    m_numbers.swap(other.m_numbers);
+    qSwap(m_packed, other.m_packed);
+    m_columns.swap(other.m_columns);
+    qSwap(m_shared, other.m_shared);
+    foreach(FwJSON::Node* item, m_data)
     {
-        FwJSON::Node* child = iter.value()->clone();
-        child->parent_ = newObject;
-        newObject->m_attributes.insert(iter.key(), child);
+        if(!m_shared)
+        {
+            item->parent_ = this;
+        }
     }
-    return newObject;
+    foreach(FwJSON::Node* item, other.m_data)
+    {
+        if(!other.m_shared)
+        {
+            item->parent_ = &other;
+        }
+    }
+    invalidate();
+    other.invalidate();
 }
 
-////////////////////////////////////////////////////////////////////////////////
-
-FwJSON::Array::Array() :
-    BaseClass()
+QByteArray FwJSON::Array::toUtf8() const
 {
-}
+    //See FwJSON::Object::toUtf8()
+    if(!utf8_.isNull())
+    {
+        return m_utf8Offset == 0 && m_utf8Size == utf8_.size() ? utf8_ : utf8_.mid(m_utf8Offset, m_utf8Size);
+    }
 
-FwJSON::Array::~Array()
-{
-    clear();
+    QByteArray utf8;
+    FwJSON::Writer writer(&utf8);
+    write(&writer);
+    return utf8;
 }
 
-void FwJSON::Array::clear()
+void FwJSON::Array::setUtf8Cached(bool cached)
 {
-    foreach(FwJSON::Node* node, m_data)
+    m_utf8Cached = cached;
+    if(!cached && !frozen_)
     {
-        Q_ASSERT(node->parent_ == this);
-        node->parent_ = nullptr;
-        delete node;
+        //See FwJSON::Object::setUtf8Cached()
+        clearUtf8Cache(this);
+        invalidate();
     }
-    m_data.clear();
 }
 
-QByteArray FwJSON::Array::toUtf8() const
+void FwJSON::Array::serialize(FwJSON::Writer* writer, QVector<Utf8Range>* cached) const
 {
-    QByteArray items;
-    foreach(FwJSON::Node* node, m_data)
+    //The caller skips arrays which serialize to nothing, see
+    //FwJSON::Object::serialize() about the cache
+    int begin = cached ? writer->buffer()->size() : 0;
+
+    writer->writeRaw('[');
+    bool written = false;
+    const FwJSON::Array* array = this;
+    if(array->m_packed)
+    {
+        foreach(double value, array->m_numbers)
+        {
+            if(written)
+            {
+                writer->writeRaw(',');
+            }
+            writer->write(value);
+            written = true;
+        }
+    }
+    int rows = array->m_columns.isEmpty() ? 0 : array->m_columns.first().present.size();
+    for(int row = 0; row < rows; row++)
+    {
+        if(written)
+        {
+            writer->writeRaw(',');
+        }
+        written = true;
+
+        writer->writeRaw('{');
+        bool first = true;
+        foreach(const FwJSON::Column& column, array->m_columns)
+        {
+            if(!column.present.testBit(row))
+            {
+                continue;
+            }
+
+            if(!first)
+            {
+                writer->writeRaw(',');
+            }
+            first = false;
+            writer->writeRaw('"');
+            writer->writeRaw(column.name.constData(), column.name.size());
+            writer->writeRaw("\":", 2);
+            switch(column.type)
+            {
+            case FwJSON::Type::Number:
+                writer->write(column.numbers.at(row));
+                break;
+
+            case FwJSON::Type::Bool:
+                writer->write(column.flags.testBit(row));
+                break;
+
+            case FwJSON::Type::String:
+                if(column.flags.testBit(row))
+                {
+                    //The value is escaped already
+                    QByteArray text = column.strings.at(row).toUtf8();
+                    writer->writeRaw('"');
+                    writer->writeRaw(text.constData(), text.size());
+                    writer->writeRaw('"');
+                }
+                else
+                {
+                    writer->write(column.strings.at(row));
+                }
+                break;
+
+            default:
+                Q_ASSERT(false);
+                break;
+            }
+        }
+        writer->writeRaw('}');
+    }
+    foreach(FwJSON::Node* node, array->m_data)
     {
-        if(!items.isEmpty())
+        //Empty items are skipped with their separators like empty
+        //attributes of objects
+        if(isEmptyUtf8(node))
+        {
+            continue;
+        }
+
+        if(written)
         {
-            items += ",";
+            writer->writeRaw(',');
         }
-        items += node->toUtf8();
+        written = true;
+        writeUtf8(node, writer, cached);
     }
-    if(items.isEmpty())
+    writer->writeRaw(']');
+
+    if(cached)
     {
-        return QByteArray();
+        Utf8Range range = { this, begin, writer->buffer()->size() - begin };
+        cached->append(range);
     }
-    return "[" + items + "]";
 }
 
 int FwJSON::Array::toInt(bool* bOk) const
 {
-    if(size() == 1)
+    if(size() == 1 && !isColumnar())
     {
+        if(isPacked())
+        {
+            return FwJSON::Number(numbers().at(0)).toInt(bOk);
+        }
         return m_data.at(0)->toInt(bOk);
     }
     (*bOk) = false;
@@ -1138,8 +3832,12 @@ int FwJSON::Array::toInt(bool* bOk) const
 
 uint FwJSON::Array::toUint(bool* bOk) const
 {
-    if(size() == 1)
+    if(size() == 1 && !isColumnar())
     {
+        if(isPacked())
+        {
+            return FwJSON::Number(numbers().at(0)).toUint(bOk);
+        }
         return m_data.at(0)->toUint(bOk);
     }
     (*bOk) = false;
@@ -1148,8 +3846,12 @@ uint FwJSON::Array::toUint(bool* bOk) const
 
 bool FwJSON::Array::toBool(bool* bOk) const
 {
-    if(size() == 1)
+    if(size() == 1 && !isColumnar())
     {
+        if(isPacked())
+        {
+            return FwJSON::Number(numbers().at(0)).toBool(bOk);
+        }
         return m_data.at(0)->toBool(bOk);
     }
     (*bOk) = false;
@@ -1158,8 +3860,12 @@ bool FwJSON::Array::toBool(bool* bOk) const
 
 double FwJSON::Array::toNumber(bool* bOk) const
 {
-    if(size() == 1)
+    if(size() == 1 && !isColumnar())
     {
+        if(isPacked())
+        {
+            return FwJSON::Number(numbers().at(0)).toNumber(bOk);
+        }
         return m_data.at(0)->toNumber(bOk);
     }
     (*bOk) = false;
@@ -1168,8 +3874,12 @@ double FwJSON::Array::toNumber(bool* bOk) const
 
 QString FwJSON::Array::toString(bool* bOk) const
 {
-    if(size() == 1)
+    if(size() == 1 && !isColumnar())
     {
+        if(isPacked())
+        {
+            return FwJSON::Number(numbers().at(0)).toString(bOk);
+        }
         return m_data.at(0)->toString(bOk);
     }
     (*bOk) = false;
@@ -1179,16 +3889,45 @@ QString FwJSON::Array::toString(bool* bOk) const
 FwJSON::Node* FwJSON::Array::clone() const
 {
     FwJSON::Array* newArray = new FwJSON::Array();
+    newArray->m_numbers = m_numbers;
+    newArray->m_packed = m_packed;
+    newArray->m_columns = m_columns;
+    if(frozen_ || m_shared)
+    {
+        //See FwJSON::Object::clone()
+        newArray->m_data = m_data;
+        newArray->m_shared = !m_data.isEmpty();
+        newArray->hash_ = hash_;
+        newArray->hashed_ = hashed_;
+        return newArray;
+    }
+
     newArray->m_data.reserve(m_data.size());
-    foreach(FwJSON::Node* child, m_data)
+    foreach(FwJSON::Node* node, m_data)
     {
-        newArray->addValue(child->clone());
+        FwJSON::Node* child = node->clone();
+        child->parent_ = newArray;
+        newArray->m_data.append(child);
     }
     return newArray;
 }
 
+void FwJSON::Array::copySharedChildren()
+{
+    //See FwJSON::Object::copySharedChildren()
+    FwJSON::Node** items = m_data.data();
+    for(int i = 0, count = m_data.size(); i < count; i++)
+    {
+        items[i] = items[i]->clone();
+        items[i]->parent_ = this;
+    }
+    m_shared = false;
+}
+
 FwJSON::Node* FwJSON::Array::addValue(FwJSON::Node* node)
 {
+    detach();
+    unpack();
     if(node->parent_)
     {
         if(node->parent_ == this)
@@ -1199,5 +3938,42 @@ FwJSON::Node* FwJSON::Array::addValue(FwJSON::Node* node)
     }
     node->parent_ = this;
     m_data.append(node);
+    invalidate();
+    return node;
+}
+
+FwJSON::Node* FwJSON::Array::addParsedValue(FwJSON::Node* node)
+{
+    Q_ASSERT(!node->parent_ && !m_shared);
+    unpack();
+    node->parent_ = this;
+    m_data.append(node);
+    return node;
+}
+
+void FwJSON::Array::appendParsedNumber(double value)
+{
+    if(m_packed || m_data.isEmpty())
+    {
+        m_packed = true;
+        m_numbers.append(value);
+    }
+    else
+    {
+        addParsedValue(new FwJSON::Number(value));
+    }
+}
+
+FwJSON::Node* FwJSON::Array::insertValue(int index, FwJSON::Node* node)
+{
+    detach();
+    unpack();
+    if(node->parent_)
+    {
+        node->takeFromParent();
+    }
+    node->parent_ = this;
+    m_data.insert(qBound(0, index, m_data.size()), node);
+    invalidate();
     return node;
 }
@@ -21,7 +21,13 @@ INCLUDEPATH += ../include/
 
 HEADERS += \
     ../include/fwjson.h \
+    ../include/fwjsonbinding.h \
+    ../include/fwjsondocument.h \
     ../include/fwjsonparser.h \
+    ../include/fwjsonpatch.h \
+    ../include/fwjsonpath.h \
+    ../include/fwjsonschema.h \
+    ../include/fwjsonwriter.h \
     ../include/fwjsoncharmap.h \
     ../include/fwjson_inl.h \
     ../include/fwjson_global.h \
@@ -30,7 +36,12 @@ HEADERS += \
     helpers/fwjsonstringhelper.h
 
 SOURCES += \
-    fwjsonparser.cpp \
+    fwjsonbinding.cpp \
+    fwjsondocument.cpp \
+    fwjsonpatch.cpp \
+    fwjsonpath.cpp \
+    fwjsonschema.cpp \
+    fwjsonwriter.cpp \
     fwjson.cpp \
     fwjsonexception.cpp \
     helpers/fwjsonhelper.cpp \
@@ -0,0 +1,554 @@
+#include <climits>
+#include <cmath>
+
+#include "fwjsonbinding.h"
+
+namespace
+{
+    const int maxSkipDepth = 512;
+
+    inline bool isSpace(char c)
+    {
+        return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+    }
+
+    inline bool isDigit(char c)
+    {
+        return c >= '0' && c <= '9';
+    }
+
+    inline bool isHexDigit(char c)
+    {
+        return isDigit(c) || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+    }
+
+    //Length of the escape sequence after the backslash, 0 if it is
+    //malformed
+    int escapeLength(const char* c_ptr, const char* end)
+    {
+        switch(c_ptr < end ? *c_ptr : 0)
+        {
+        case '"':
+        case '\\':
+        case '/':
+        case 'b':
+        case 'f':
+        case 'n':
+        case 'r':
+        case 't':
+            return 1;
+
+        case 'u':
+            if(end - c_ptr > 4 && isHexDigit(c_ptr[1]) && isHexDigit(c_ptr[2]) &&
+               isHexDigit(c_ptr[3]) && isHexDigit(c_ptr[4]))
+            {
+                return 5;
+            }
+            return 0;
+
+        default:
+            return 0;
+        }
+    }
+
+    //Powers of ten which are exact doubles
+    const double exactPowers[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+}
+
+FwJSON::Reader::Reader(const QByteArray& utf8String) :
+    m_source(utf8String),
+    m_begin(m_source.constData()),
+    m_end(m_begin + m_source.size()),
+    m_current(m_begin),
+    m_depth(0)
+{
+}
+
+void FwJSON::Reader::skipSpaces()
+{
+    while(m_current < m_end && isSpace(*m_current))
+    {
+        m_current++;
+    }
+}
+
+void FwJSON::Reader::expect(char c)
+{
+    skipSpaces();
+    if(m_current >= m_end || *m_current != c)
+    {
+        fail(QByteArray("Expected '") + c + "'");
+    }
+    m_current++;
+}
+
+void FwJSON::Reader::fail(const QByteArray& error) const
+{
+    int line = 1;
+    int column = 0;
+    for(const char* c_ptr = m_begin; c_ptr < m_current; c_ptr++)
+    {
+        column++;
+        if(*c_ptr == '\n')
+        {
+            line++;
+            column = 0;
+        }
+    }
+    throw FwJSON::Exception(error, line, column);
+}
+
+void FwJSON::Reader::finish()
+{
+    skipSpaces();
+    if(m_current != m_end)
+    {
+        fail("Unexpected data after the document");
+    }
+}
+
+bool FwJSON::Reader::readNull()
+{
+    skipSpaces();
+    if(m_end - m_current >= 4 && memcmp(m_current, FwJSON::constantNull, 4) == 0)
+    {
+        m_current += 4;
+        return true;
+    }
+    return false;
+}
+
+void FwJSON::Reader::stringRange(int* begin, int* end, bool* escaped)
+{
+    expect('"');
+    (*begin) = static_cast<int>(m_current - m_begin);
+    (*escaped) = false;
+    for(; m_current < m_end; m_current++)
+    {
+        if(*m_current == '\\')
+        {
+            int length = escapeLength(m_current + 1, m_end);
+            if(!length)
+            {
+                fail("Invalid escape sequence");
+            }
+            (*escaped) = true;
+            m_current += length;
+        }
+        else if(*m_current == '"')
+        {
+            (*end) = static_cast<int>(m_current - m_begin);
+            m_current++;
+            return;
+        }
+        else if(static_cast<quint8>(*m_current) < 0x20)
+        {
+            fail("Control character in string");
+        }
+    }
+    fail("Unterminated string");
+}
+
+double FwJSON::Reader::number()
+{
+    skipSpaces();
+    const char* token = m_current;
+    bool negative = m_current < m_end && *m_current == '-';
+    if(negative)
+    {
+        m_current++;
+    }
+
+    //The grammar of the parser: the integer part has no leading zeros
+    //and a point is followed by digits
+    if(m_current == m_end || !isDigit(*m_current) ||
+       (*m_current == '0' && m_current + 1 < m_end && isDigit(m_current[1])))
+    {
+        fail("Invalid number value");
+    }
+
+    //Up to 15 significant digits and a small exponent are converted
+    //exactly by one multiplication or division
+    quint64 mantissa = 0;
+    int significant = 0;
+    int exponent = 0;
+    for(; m_current < m_end && isDigit(*m_current); m_current++)
+    {
+        if(mantissa > 0 || *m_current != '0')
+        {
+            significant++;
+        }
+        mantissa = mantissa * 10 + (*m_current - '0');
+    }
+    if(m_current < m_end && *m_current == '.')
+    {
+        m_current++;
+        if(m_current == m_end || !isDigit(*m_current))
+        {
+            fail("Invalid number value");
+        }
+        for(; m_current < m_end && isDigit(*m_current); m_current++, exponent--)
+        {
+            if(mantissa > 0 || *m_current != '0')
+            {
+                significant++;
+            }
+            mantissa = mantissa * 10 + (*m_current - '0');
+        }
+    }
+
+    if(m_current < m_end && (*m_current == 'e' || *m_current == 'E'))
+    {
+        m_current++;
+        bool negativeExponent = m_current < m_end && *m_current == '-';
+        if(m_current < m_end && (*m_current == '-' || *m_current == '+'))
+        {
+            m_current++;
+        }
+        int value = 0;
+        int exponentDigits = 0;
+        for(; m_current < m_end && isDigit(*m_current); m_current++, exponentDigits++)
+        {
+            value = qMin(value * 10 + (*m_current - '0'), 100000);
+        }
+        if(exponentDigits == 0)
+        {
+            fail("Invalid number value");
+        }
+        exponent += negativeExponent ? -value : value;
+    }
+
+    if(significant <= 15 && exponent >= -22 && exponent <= 22)
+    {
+        double value = static_cast<double>(mantissa);
+        value = exponent < 0 ? value / exactPowers[-exponent] : value * exactPowers[exponent];
+        return negative ? -value : value;
+    }
+
+    bool bOk = false;
+    double value = QByteArray(token, static_cast<int>(m_current - token)).toDouble(&bOk);
+    if(!bOk)
+    {
+        fail("Invalid number value");
+    }
+    return value;
+}
+
+void FwJSON::Reader::read(bool* value)
+{
+    skipSpaces();
+    if(m_end - m_current >= 4 && memcmp(m_current, FwJSON::constantTrue, 4) == 0)
+    {
+        (*value) = true;
+        m_current += 4;
+    }
+    else if(m_end - m_current >= 5 && memcmp(m_current, FwJSON::constantFalse, 5) == 0)
+    {
+        (*value) = false;
+        m_current += 5;
+    }
+    else if(!readNull())
+    {
+        fail("Invalid boolean value");
+    }
+}
+
+qint64 FwJSON::Reader::integer(qint64 minimum, qint64 maximum, const char* type)
+{
+    //Integers are read exactly, doubles lose precision above 2^53
+    skipSpaces();
+    const char* token = m_current;
+    bool negative = m_current < m_end && *m_current == '-';
+    const char* c_ptr = negative ? m_current + 1 : m_current;
+    quint64 magnitude = 0;
+    bool overflow = false;
+    int digits = 0;
+    for(; c_ptr < m_end && isDigit(*c_ptr); c_ptr++, digits++)
+    {
+        quint64 digit = static_cast<quint64>(*c_ptr - '0');
+        overflow = overflow || magnitude > (ULLONG_MAX - digit) / 10;
+        magnitude = magnitude * 10 + digit;
+    }
+    //Leading zeros are left to number(), which rejects them
+    bool leadingZero = digits > 1 && (negative ? token[1] : token[0]) == '0';
+    if(digits > 0 && !leadingZero && (c_ptr == m_end || (*c_ptr != '.' && *c_ptr != 'e' && *c_ptr != 'E')))
+    {
+        m_current = c_ptr;
+        quint64 limit = negative ? (minimum < 0 ? static_cast<quint64>(-(minimum + 1)) + 1 : 0) :
+                                   static_cast<quint64>(maximum);
+        if(overflow || magnitude > limit)
+        {
+            fail(QByteArray("Number does not fit ") + type);
+        }
+        return negative ? static_cast<qint64>(0u - magnitude) : static_cast<qint64>(magnitude);
+    }
+
+    //Fractions and exponents are taken if the value is integral, like
+    //1.0 or 1e3
+    m_current = token;
+    double number = this->number();
+    if(number != std::floor(number))
+    {
+        fail(QByteArray("Number is not an integer, ") + type + " expected");
+    }
+    if(number < static_cast<double>(minimum) || number >= static_cast<double>(maximum) + 1.)
+    {
+        fail(QByteArray("Number does not fit ") + type);
+    }
+    return static_cast<qint64>(number);
+}
+
+void FwJSON::Reader::read(int* value)
+{
+    if(!readNull())
+    {
+        (*value) = static_cast<int>(integer(INT_MIN, INT_MAX, "int"));
+    }
+}
+
+void FwJSON::Reader::read(uint* value)
+{
+    if(!readNull())
+    {
+        (*value) = static_cast<uint>(integer(0, UINT_MAX, "uint"));
+    }
+}
+
+void FwJSON::Reader::read(qint64* value)
+{
+    if(!readNull())
+    {
+        (*value) = integer(LLONG_MIN, LLONG_MAX, "qint64");
+    }
+}
+
+void FwJSON::Reader::read(double* value)
+{
+    if(!readNull())
+    {
+        (*value) = number();
+    }
+}
+
+void FwJSON::Reader::read(QString* value)
+{
+    if(readNull())
+    {
+        return;
+    }
+
+    int begin = 0;
+    int end = 0;
+    bool escaped = false;
+    stringRange(&begin, &end, &escaped);
+    if(!escaped)
+    {
+        (*value) = QString::fromUtf8(m_begin + begin, end - begin);
+        return;
+    }
+
+    QByteArray utf8;
+    if(!FwJSON::unescapeUtf8(m_begin + begin, end - begin, &utf8))
+    {
+        fail("Invalid escape sequence");
+    }
+    (*value) = QString::fromUtf8(utf8);
+}
+
+void FwJSON::Reader::read(QByteArray* value)
+{
+    if(readNull())
+    {
+        return;
+    }
+
+    int begin = 0;
+    int end = 0;
+    bool escaped = false;
+    stringRange(&begin, &end, &escaped);
+    if(!escaped)
+    {
+        (*value) = QByteArray(m_begin + begin, end - begin);
+        return;
+    }
+
+    value->resize(0);
+    if(!FwJSON::unescapeUtf8(m_begin + begin, end - begin, value))
+    {
+        fail("Invalid escape sequence");
+    }
+}
+
+void FwJSON::Reader::skipValue()
+{
+    skipSpaces();
+    if(m_current >= m_end)
+    {
+        fail("Unexpected end of the document");
+    }
+
+    if(++m_depth > maxSkipDepth)
+    {
+        fail("Nesting is too deep");
+    }
+
+    switch(*m_current)
+    {
+    case '{':
+        {
+            const char* name = nullptr;
+            int size = 0;
+            beginObject();
+            while(nextAttribute(&name, &size))
+            {
+                skipValue();
+            }
+        }
+        break;
+
+    case '[':
+        beginArray();
+        while(nextItem())
+        {
+            skipValue();
+        }
+        break;
+
+    case '"':
+        {
+            int begin = 0;
+            int end = 0;
+            bool escaped = false;
+            stringRange(&begin, &end, &escaped);
+        }
+        break;
+
+    case 't':
+    case 'f':
+        {
+            bool value = false;
+            read(&value);
+        }
+        break;
+
+    case 'n':
+        if(!readNull())
+        {
+            fail("Invalid value");
+        }
+        break;
+
+    default:
+        number();
+        break;
+    }
+    m_depth--;
+}
+
+FwJSON::Type FwJSON::Reader::peek()
+{
+    skipSpaces();
+    if(m_current >= m_end)
+    {
+        fail("Unexpected end of the document");
+    }
+
+    switch(*m_current)
+    {
+    case '{':
+        return FwJSON::Type::Object;
+
+    case '[':
+        return FwJSON::Type::Array;
+
+    case '"':
+        return FwJSON::Type::String;
+
+    case 't':
+    case 'f':
+        return FwJSON::Type::Bool;
+
+    case 'n':
+        return FwJSON::Type::Null;
+
+    default:
+        return FwJSON::Type::Number;
+    }
+}
+
+void FwJSON::Reader::beginObject()
+{
+    expect('{');
+}
+
+bool FwJSON::Reader::nextAttribute(const char** name, int* size)
+{
+    int begin = 0;
+    int end = 0;
+    bool escaped = false;
+    if(!nextAttributeRange(&begin, &end, &escaped))
+    {
+        return false;
+    }
+    if(escaped)
+    {
+        //The buffer keeps its capacity for the next names
+        m_name.resize(0);
+        if(!FwJSON::unescapeUtf8(m_begin + begin, end - begin, &m_name))
+        {
+            fail("Invalid escape sequence");
+        }
+        (*name) = m_name.constData();
+        (*size) = m_name.size();
+    }
+    else
+    {
+        (*name) = m_begin + begin;
+        (*size) = end - begin;
+    }
+    return true;
+}
+
+bool FwJSON::Reader::nextAttributeRange(int* begin, int* end, bool* escaped)
+{
+    //Values never end with '{', so it tells the first attribute
+    bool first = m_current[-1] == '{';
+    skipSpaces();
+    if(m_current < m_end && *m_current == '}')
+    {
+        m_current++;
+        return false;
+    }
+    if(!first)
+    {
+        expect(',');
+    }
+
+    stringRange(begin, end, escaped);
+    expect(':');
+    return true;
+}
+
+void FwJSON::Reader::beginArray()
+{
+    expect('[');
+}
+
+bool FwJSON::Reader::nextItem()
+{
+    bool first = m_current[-1] == '[';
+    skipSpaces();
+    if(m_current < m_end && *m_current == ']')
+    {
+        m_current++;
+        return false;
+    }
+    if(!first)
+    {
+        expect(',');
+    }
+    return true;
+}
@@ -0,0 +1,60 @@
+#include <QtCore/QThread>
+
+#include "fwjsondocument.h"
+
+FwJSON::SharedDocument::SharedDocument(FwJSON::Node* root) :
+    m_root(nullptr),
+    m_epoch(0)
+{
+    m_readers[0] = 0;
+    m_readers[1] = 0;
+    if(root)
+    {
+        root->freeze();
+        m_root.store(root);
+    }
+}
+
+FwJSON::SharedDocument::~SharedDocument()
+{
+    Q_ASSERT(m_readers[0] == 0 && m_readers[1] == 0);
+    delete m_root.load();
+}
+
+void FwJSON::SharedDocument::publish(FwJSON::Node* root)
+{
+    if(root)
+    {
+        root->freeze();
+    }
+
+    QMutexLocker locker(&m_publishMutex);
+    FwJSON::Node* previous = m_root.exchange(root);
+
+    //Readers which enter after the switch of the epoch see the new root,
+    //so the previous one is used only by readers of the previous epoch
+    int epoch = m_epoch.load();
+    m_epoch.store(epoch ^ 1);
+    while(m_readers[epoch].load() != 0)
+    {
+        QThread::yieldCurrentThread();
+    }
+    delete previous;
+}
+
+int FwJSON::SharedDocument::enter() const
+{
+    //The counter is incremented before the root is loaded, if the epoch
+    //was switched meanwhile the publisher may already wait for the
+    //other counter, so the reader retries with the new epoch
+    for(;;)
+    {
+        int epoch = m_epoch.load();
+        m_readers[epoch].fetch_add(1);
+        if(m_epoch.load() == epoch)
+        {
+            return epoch;
+        }
+        m_readers[epoch].fetch_sub(1);
+    }
+}
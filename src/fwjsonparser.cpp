@@ -1,5 +0,0 @@
-#include "fwjsonparser.h"
-
-FwJSON::Parser::Parser()
-{
-}
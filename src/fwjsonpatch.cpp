@@ -0,0 +1,417 @@
+#include <QtCore/QScopedPointer>
+
+#include "fwjsonpatch.h"
+#include "fwjsonpath.h"
+
+namespace
+{
+    QString stringValue(const FwJSON::String* string)
+    {
+        if(!string->hasEscapes())
+        {
+            return string->value();
+        }
+        bool bOk = false;
+        return string->toString(&bOk);
+    }
+
+    QByteArray escapeToken(const QByteArray& token)
+    {
+        QByteArray escaped = token;
+        return escaped.replace('~', "~0").replace('/', "~1");
+    }
+
+    //Attribute names keep the escapes of the document, tokens of the
+    //paths hold the text
+    QByteArray decodedName(const QByteArray& name)
+    {
+        QByteArray decoded;
+        if(!name.contains('\\') || !FwJSON::unescapeUtf8(name.constData(), name.size(), &decoded))
+        {
+            return name;
+        }
+        return decoded;
+    }
+
+    class Differ
+    {
+    public:
+        explicit Differ(FwJSON::Array* patch) :
+            m_patch(patch)
+        {
+        }
+
+        void diff(const FwJSON::Node* source, const FwJSON::Node* target, const QByteArray& path);
+
+    private:
+        void addOperation(const char* operation, const QByteArray& path, const FwJSON::Node* value = nullptr);
+
+        FwJSON::Array* m_patch;
+    };
+
+    void Differ::addOperation(const char* operation, const QByteArray& path, const FwJSON::Node* value)
+    {
+        FwJSON::Object* object = m_patch->addObject();
+        object->addString("op", QString::fromLatin1(operation));
+        //String values keep the escapes of the document
+        QByteArray escapedPath;
+        object->addString("path", QString::fromUtf8(FwJSON::escapeUtf8(QString::fromUtf8(path), &escapedPath) ? escapedPath : path));
+        if(value)
+        {
+            object->addAttribute("value", value->clone());
+        }
+    }
+
+    void Differ::diff(const FwJSON::Node* source, const FwJSON::Node* target, const QByteArray& path)
+    {
+        //Compares the cached subtree hashes first
+        if(source->equals(target))
+        {
+            return;
+        }
+
+        if(source->type() != target->type())
+        {
+            addOperation("replace", path, target);
+            return;
+        }
+
+        switch(source->type())
+        {
+        case FwJSON::Type::Object:
+            {
+                const FwJSON::Object* sourceObject = static_cast<const FwJSON::Object*>(source);
+                const FwJSON::Object* targetObject = static_cast<const FwJSON::Object*>(target);
+                for(const FwJSON::Attribute& attribute : *sourceObject)
+                {
+                    QByteArray childPath = path + "/" + escapeToken(decodedName(attribute.name));
+                    if(const FwJSON::Node* value = targetObject->attribute(attribute.name))
+                    {
+                        diff(attribute.value, value, childPath);
+                    }
+                    else
+                    {
+                        addOperation("remove", childPath);
+                    }
+                }
+                for(const FwJSON::Attribute& attribute : *targetObject)
+                {
+                    if(!sourceObject->attribute(attribute.name))
+                    {
+                        addOperation("add", path + "/" + escapeToken(decodedName(attribute.name)), attribute.value);
+                    }
+                }
+            }
+            break;
+
+        case FwJSON::Type::Array:
+            {
+                const FwJSON::Array* sourceArray = static_cast<const FwJSON::Array*>(source);
+                const FwJSON::Array* targetArray = static_cast<const FwJSON::Array*>(target);
+                int sourceSize = sourceArray->size();
+                int targetSize = targetArray->size();
+                int common = qMin(sourceSize, targetSize);
+
+                //Packed and columnar arrays are read without unpacking
+                QScopedPointer<FwJSON::Node> sourceItem;
+                QScopedPointer<FwJSON::Node> targetItem;
+
+                int head = 0;
+                while(head < common &&
+                      sourceArray->itemView(head, &sourceItem)->equals(targetArray->itemView(head, &targetItem)))
+                {
+                    head++;
+                }
+
+                int tail = 0;
+                while(tail < common - head &&
+                      sourceArray->itemView(sourceSize - tail - 1, &sourceItem)->equals(
+                          targetArray->itemView(targetSize - tail - 1, &targetItem)))
+                {
+                    tail++;
+                }
+
+                int changed = common - head - tail;
+                for(int i = head; i < head + changed; i++)
+                {
+                    diff(sourceArray->itemView(i, &sourceItem), targetArray->itemView(i, &targetItem),
+                         path + "/" + QByteArray::number(i));
+                }
+
+                //Removed from the end so indexes of the rest do not change
+                for(int i = sourceSize - tail - 1; i >= head + changed; i--)
+                {
+                    addOperation("remove", path + "/" + QByteArray::number(i));
+                }
+
+                for(int i = head + changed; i < targetSize - tail; i++)
+                {
+                    addOperation("add", path + "/" + QByteArray::number(i), targetArray->itemView(i, &targetItem));
+                }
+            }
+            break;
+
+        default:
+            addOperation("replace", path, target);
+            break;
+        }
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+
+    //Names without escapes are their text, other ones are compared
+    //decoded
+    FwJSON::Node* attribute(FwJSON::Object* object, const QByteArray& token)
+    {
+        if(!token.contains('\\'))
+        {
+            if(FwJSON::Node* node = object->attribute(token))
+            {
+                return node;
+            }
+        }
+        for(const FwJSON::Attribute& attribute : *object)
+        {
+            if(attribute.name.contains('\\') && decodedName(attribute.name) == token)
+            {
+                return attribute.value;
+            }
+        }
+        return nullptr;
+    }
+
+    FwJSON::Node* child(FwJSON::Node* node, const QByteArray& token)
+    {
+        if(FwJSON::Object* object = FwJSON::cast<FwJSON::Object>(node))
+        {
+            return attribute(object, token);
+        }
+        if(FwJSON::Array* array = FwJSON::cast<FwJSON::Array>(node))
+        {
+            return array->item(FwJSON::Path::arrayIndex(token));
+        }
+        return nullptr;
+    }
+
+    FwJSON::Node* find(FwJSON::Node* root, const QList<QByteArray>& tokens, int size)
+    {
+        FwJSON::Node* node = root;
+        for(int i = 0; i < size && node; i++)
+        {
+            node = child(node, tokens.at(i));
+        }
+        return node;
+    }
+
+    FwJSON::Node* find(FwJSON::Node* root, const QByteArray& path)
+    {
+        QList<QByteArray> tokens = FwJSON::Path::split(path);
+        return find(root, tokens, tokens.size());
+    }
+
+    QByteArray stringAttribute(const FwJSON::Object* operation, const char* name)
+    {
+        const FwJSON::String* string = FwJSON::cast<FwJSON::String>(operation->attribute(name));
+        if(!string)
+        {
+            throw FwJSON::Exception(QByteArray("Patch operation has no \"") + name + "\" string");
+        }
+        return stringValue(string).toUtf8();
+    }
+
+    //The root keeps its address, so only children of objects and arrays
+    //can be replaced there. The holder keeps the value if it throws
+    void replaceRoot(FwJSON::Node* root, QScopedPointer<FwJSON::Node>* value)
+    {
+        if(root->type() != (*value)->type())
+        {
+            throw FwJSON::Exception("Patch can not change type of the root");
+        }
+
+        if(FwJSON::Object* object = FwJSON::cast<FwJSON::Object>(root))
+        {
+            object->swap(*static_cast<FwJSON::Object*>(value->data()));
+        }
+        else if(FwJSON::Array* array = FwJSON::cast<FwJSON::Array>(root))
+        {
+            array->swap(*static_cast<FwJSON::Array*>(value->data()));
+        }
+        else
+        {
+            throw FwJSON::Exception("Patch can not replace the root value");
+        }
+        value->reset();
+    }
+
+    //Takes the value from the holder unless it throws
+    void addValue(FwJSON::Node* root, const QByteArray& path, QScopedPointer<FwJSON::Node>* value)
+    {
+        QList<QByteArray> tokens = FwJSON::Path::split(path);
+        if(tokens.isEmpty())
+        {
+            replaceRoot(root, value);
+            return;
+        }
+
+        FwJSON::Node* parent = find(root, tokens, tokens.size() - 1);
+        const QByteArray& name = tokens.last();
+        if(FwJSON::Object* object = FwJSON::cast<FwJSON::Object>(parent))
+        {
+            //A replaced attribute keeps its name, new names are escaped
+            QByteArray attributeName;
+            if(FwJSON::Node* current = attribute(object, name))
+            {
+                attributeName = object->attributeName(current);
+            }
+            else
+            {
+                FwJSON::escapeUtf8(QString::fromUtf8(name), &attributeName);
+            }
+            object->addAttribute(attributeName, value->take(), true);
+        }
+        else if(FwJSON::Array* array = FwJSON::cast<FwJSON::Array>(parent))
+        {
+            int index = name == "-" ? array->size() : FwJSON::Path::arrayIndex(name);
+            if(index < 0 || index > array->size())
+            {
+                throw FwJSON::Exception("Patch index is out of range: " + path);
+            }
+            array->insertValue(index, value->take());
+        }
+        else
+        {
+            throw FwJSON::Exception("Patch path does not exist: " + path);
+        }
+    }
+
+    FwJSON::Node* existingNode(FwJSON::Node* root, const QByteArray& path)
+    {
+        FwJSON::Node* node = find(root, path);
+        if(!node)
+        {
+            throw FwJSON::Exception("Patch path does not exist: " + path);
+        }
+        return node;
+    }
+}
+
+FwJSON::Array* FwJSON::diff(const FwJSON::Node* source, const FwJSON::Node* target)
+{
+    FwJSON::Array* patch = new FwJSON::Array();
+    Differ(patch).diff(source, target, QByteArray());
+    return patch;
+}
+
+void FwJSON::applyPatch(FwJSON::Node* root, const FwJSON::Array& patch)
+{
+    for(const FwJSON::Node* node : patch)
+    {
+        const FwJSON::Object* operation = cast<FwJSON::Object>(node);
+        if(!operation)
+        {
+            throw FwJSON::Exception("Patch operation is not an object");
+        }
+
+        QByteArray op = stringAttribute(operation, "op");
+        QByteArray path = stringAttribute(operation, "path");
+        const FwJSON::Node* value = operation->attribute("value");
+        if(!value && (op == "add" || op == "replace" || op == "test"))
+        {
+            throw FwJSON::Exception("Patch operation has no value: " + op);
+        }
+
+        if(op == "add")
+        {
+            QScopedPointer<FwJSON::Node> holder(value->clone());
+            addValue(root, path, &holder);
+        }
+        else if(op == "remove")
+        {
+            FwJSON::Node* target = existingNode(root, path);
+            if(target == root)
+            {
+                throw FwJSON::Exception("Patch can not remove the root");
+            }
+            delete target;
+        }
+        else if(op == "replace")
+        {
+            FwJSON::Node* target = existingNode(root, path);
+            if(target == root)
+            {
+                QScopedPointer<FwJSON::Node> holder(value->clone());
+                replaceRoot(root, &holder);
+            }
+            else if(FwJSON::Array* array = cast<FwJSON::Array>(target->parent()))
+            {
+                array->insertValue(array->indexOf(target), value->clone());
+                delete target;
+            }
+            else
+            {
+                static_cast<FwJSON::Object*>(target->parent())->addAttribute(target->name(), value->clone(), true);
+            }
+        }
+        else if(op == "move")
+        {
+            QByteArray from = stringAttribute(operation, "from");
+            if(from == path)
+            {
+                existingNode(root, from);
+                continue;
+            }
+            if(path.startsWith(from + "/"))
+            {
+                throw FwJSON::Exception("Patch can not move a value into itself: " + path);
+            }
+            FwJSON::Node* source = existingNode(root, from);
+            if(source == root)
+            {
+                throw FwJSON::Exception("Patch can not move the root");
+            }
+
+            //The source goes back if it can not be added, an object gets
+            //it at the end
+            FwJSON::Object* object = cast<FwJSON::Object>(source->parent());
+            FwJSON::Array* array = cast<FwJSON::Array>(source->parent());
+            QByteArray name = object ? object->attributeName(source) : QByteArray();
+            int index = array ? array->indexOf(source) : -1;
+            source->takeFromParent();
+            QScopedPointer<FwJSON::Node> holder(source);
+            try
+            {
+                addValue(root, path, &holder);
+            }
+            catch(const FwJSON::Exception&)
+            {
+                holder.take();
+                if(object)
+                {
+                    object->addAttribute(name, source, true);
+                }
+                else
+                {
+                    array->insertValue(index, source);
+                }
+                throw;
+            }
+        }
+        else if(op == "copy")
+        {
+            QByteArray from = stringAttribute(operation, "from");
+            QScopedPointer<FwJSON::Node> holder(existingNode(root, from)->clone());
+            addValue(root, path, &holder);
+        }
+        else if(op == "test")
+        {
+            if(!existingNode(root, path)->equals(value))
+            {
+                throw FwJSON::Exception("Patch test failed: " + path);
+            }
+        }
+        else
+        {
+            throw FwJSON::Exception("Unknown patch operation: " + op);
+        }
+    }
+}
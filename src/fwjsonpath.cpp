@@ -0,0 +1,291 @@
+#include <climits>
+
+#include "fwjsonpath.h"
+
+namespace
+{
+    bool parseBound(const QByteArray& token, int defaultValue, int* bound)
+    {
+        if(token.isEmpty())
+        {
+            (*bound) = defaultValue;
+            return true;
+        }
+
+        bool negative = token.at(0) == '-';
+        int index = FwJSON::Path::arrayIndex(negative ? token.mid(1) : token);
+        if(index < 0)
+        {
+            return false;
+        }
+        (*bound) = negative ? -index : index;
+        return true;
+    }
+
+    int sliceBound(int bound, int size)
+    {
+        if(bound < 0)
+        {
+            bound += size;
+        }
+        return qBound(0, bound, size);
+    }
+
+    bool appendNode(FwJSON::Node* node, void* context)
+    {
+        static_cast<QVector<FwJSON::Node*>*>(context)->append(node);
+        return true;
+    }
+
+    bool countNode(FwJSON::Node*, void* context)
+    {
+        (*static_cast<int*>(context))++;
+        return true;
+    }
+
+    bool firstNode(FwJSON::Node* node, void* context)
+    {
+        (*static_cast<FwJSON::Node**>(context)) = node;
+        return false;
+    }
+
+    bool addStatistics(FwJSON::Node* node, void* context)
+    {
+        FwJSON::Statistics* statistics = static_cast<FwJSON::Statistics*>(context);
+        if(const FwJSON::Number* number = FwJSON::cast<FwJSON::Number>(node))
+        {
+            statistics->add(number->value());
+        }
+        else if(const FwJSON::Array* array = FwJSON::cast<FwJSON::Array>(node))
+        {
+            statistics->add(array->statistics());
+        }
+        return true;
+    }
+
+    bool addHistogram(FwJSON::Node* node, void* context)
+    {
+        FwJSON::Histogram* histogram = static_cast<FwJSON::Histogram*>(context);
+        if(const FwJSON::Number* number = FwJSON::cast<FwJSON::Number>(node))
+        {
+            histogram->add(number->value());
+        }
+        else if(const FwJSON::Array* array = FwJSON::cast<FwJSON::Array>(node))
+        {
+            histogram->add(array->histogram(histogram->min, histogram->max, histogram->bins.size()));
+        }
+        return true;
+    }
+}
+
+FwJSON::Path::Path(const QByteArray& pointer) :
+    m_pointer(pointer),
+    m_single(true)
+{
+    foreach(const QByteArray& token, split(pointer))
+    {
+        Step step;
+        step.name = token;
+        step.hash = 0;
+        step.index = -1;
+        step.end = INT_MAX;
+
+        if(token == "*")
+        {
+            step.kind = Step::Wildcard;
+            m_single = false;
+            m_steps.append(step);
+            continue;
+        }
+
+        step.hash = hashName(step.name.constData(), step.name.size());
+
+        int colon = step.name.indexOf(':');
+        if(colon >= 0 &&
+           parseBound(step.name.left(colon), 0, &step.index) &&
+           parseBound(step.name.mid(colon + 1), INT_MAX, &step.end))
+        {
+            step.kind = Step::Slice;
+            m_single = false;
+        }
+        else
+        {
+            step.kind = Step::Name;
+            step.index = arrayIndex(step.name);
+        }
+        m_steps.append(step);
+    }
+}
+
+QList<QByteArray> FwJSON::Path::split(const QByteArray& pointer)
+{
+    QList<QByteArray> tokens;
+    if(pointer.isEmpty())
+    {
+        return tokens;
+    }
+
+    if(pointer.at(0) != '/')
+    {
+        throw FwJSON::Exception("Path must start with '/': " + pointer);
+    }
+
+    foreach(const QByteArray& token, pointer.mid(1).split('/'))
+    {
+        QByteArray name;
+        name.reserve(token.size());
+        for(int i = 0; i < token.size(); i++)
+        {
+            char c = token.at(i);
+            if(c == '~')
+            {
+                char next = i + 1 < token.size() ? token.at(i + 1) : '\0';
+                if(next != '0' && next != '1')
+                {
+                    throw FwJSON::Exception("Invalid escape sequence in path: " + pointer);
+                }
+                name += (next == '0' ? '~' : '/');
+                i++;
+            }
+            else
+            {
+                name += c;
+            }
+        }
+        tokens.append(name);
+    }
+    return tokens;
+}
+
+int FwJSON::Path::arrayIndex(const QByteArray& token)
+{
+    if(token.isEmpty() || token.size() > 9 || (token.size() > 1 && token.at(0) == '0'))
+    {
+        return -1;
+    }
+
+    int index = 0;
+    foreach(char c, token)
+    {
+        if(c < '0' || c > '9')
+        {
+            return -1;
+        }
+        index = index * 10 + (c - '0');
+    }
+    return index;
+}
+
+FwJSON::Node* FwJSON::Path::first(FwJSON::Node* root) const
+{
+    FwJSON::Node* node = nullptr;
+    evaluate(root, 0, &firstNode, &node, false);
+    return node;
+}
+
+int FwJSON::Path::evaluate(FwJSON::Node* root, QVector<FwJSON::Node*>* nodes) const
+{
+    int size = nodes->size();
+    evaluate(root, 0, &appendNode, nodes, false);
+    return nodes->size() - size;
+}
+
+int FwJSON::Path::count(FwJSON::Node* root) const
+{
+    int count = 0;
+    evaluate(root, 0, &countNode, &count, true);
+    return count;
+}
+
+FwJSON::Statistics FwJSON::Path::statistics(FwJSON::Node* root) const
+{
+    FwJSON::Statistics statistics;
+    evaluate(root, 0, &addStatistics, &statistics, true);
+    return statistics;
+}
+
+QVector<int> FwJSON::Path::histogram(FwJSON::Node* root, double min, double max, int bins) const
+{
+    FwJSON::Histogram histogram(min, max, bins);
+    if(!histogram.bins.isEmpty())
+    {
+        evaluate(root, 0, &addHistogram, &histogram, true);
+    }
+    return histogram.bins;
+}
+
+bool FwJSON::Path::evaluate(FwJSON::Node* node, int step, Callback callback, void* context, bool view) const
+{
+    //Views of packed and columnar items are passed only to callbacks
+    //which read them, rows hold no arrays, so one temporary is enough
+    QScopedPointer<FwJSON::Node> temporary;
+
+    //Name steps follow a single branch and are executed in the loop,
+    //only wildcards and slices recurse
+    for(; node && step < m_steps.size(); step++)
+    {
+        const Step& current = m_steps.at(step);
+        if(FwJSON::Object* object = cast<FwJSON::Object>(node))
+        {
+            //Visited nodes may be changed, views are only read
+            if(!view)
+            {
+                object->detach();
+            }
+
+            if(current.kind == Step::Wildcard)
+            {
+                foreach(const FwJSON::Attribute& attribute, object->m_attributes)
+                {
+                    if(!evaluate(attribute.value, step + 1, callback, context, view))
+                    {
+                        return false;
+                    }
+                }
+                return true;
+            }
+
+            int index = object->indexOf(current.name.constData(), current.name.size(), current.hash);
+            node = index < 0 ? nullptr : object->m_attributes.at(index).value;
+        }
+        else if(FwJSON::Array* array = cast<FwJSON::Array>(node))
+        {
+            if(current.kind == Step::Name)
+            {
+                node = item(array, current.index, &temporary, view);
+                continue;
+            }
+
+            int size = array->size();
+            int begin = 0;
+            int end = size;
+            if(current.kind == Step::Slice)
+            {
+                begin = sliceBound(current.index, size);
+                end = sliceBound(current.end, size);
+            }
+            for(int index = begin; index < end; index++)
+            {
+                if(!evaluate(item(array, index, &temporary, view), step + 1, callback, context, view))
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+        else
+        {
+            node = nullptr;
+        }
+    }
+    return node ? callback(node, context) : true;
+}
+
+FwJSON::Node* FwJSON::Path::item(FwJSON::Array* array, int index, QScopedPointer<FwJSON::Node>* temporary, bool view)
+{
+    if(view)
+    {
+        return const_cast<FwJSON::Node*>(array->itemView(index, temporary));
+    }
+    return array->item(index);
+}
@@ -0,0 +1,665 @@
+#include <climits>
+#include <cmath>
+#include <limits>
+
+#include "fwjsonschema.h"
+#include "fwjsonbinding.h"
+
+namespace
+{
+    inline int typeBit(FwJSON::Type type)
+    {
+        return 1 << static_cast<int>(type);
+    }
+
+    //String nodes keep the escapes of the document, the rules compare
+    //the text the reader decodes
+    QString stringText(const FwJSON::String* string)
+    {
+        if(!string->hasEscapes())
+        {
+            return string->value();
+        }
+        bool bOk = false;
+        return string->toString(&bOk);
+    }
+
+    double numberKeyword(const FwJSON::Object& schema, const char* name, double defaultValue)
+    {
+        const FwJSON::Node* node = schema.attribute(name);
+        if(!node)
+        {
+            return defaultValue;
+        }
+
+        const FwJSON::Number* number = FwJSON::cast<FwJSON::Number>(node);
+        if(!number)
+        {
+            throw FwJSON::Exception(QByteArray("Schema keyword \"") + name + "\" is not a number");
+        }
+        return number->value();
+    }
+
+    int lengthKeyword(const FwJSON::Object& schema, const char* name, int defaultValue)
+    {
+        double value = numberKeyword(schema, name, defaultValue);
+        if(value < 0. || value != std::floor(value))
+        {
+            throw FwJSON::Exception(QByteArray("Schema keyword \"") + name + "\" is not a non-negative integer");
+        }
+        return value < INT_MAX ? static_cast<int>(value) : INT_MAX;
+    }
+}
+
+FwJSON::Schema::Schema(const FwJSON::Object& schema)
+{
+    compile(schema);
+}
+
+void FwJSON::Schema::validate(const FwJSON::Node* node) const
+{
+    check(0, node, nullptr);
+}
+
+void FwJSON::Schema::validate(const QByteArray& utf8String) const
+{
+    FwJSON::Reader reader(utf8String);
+    check(0, &reader, nullptr);
+    reader.finish();
+}
+
+bool FwJSON::Schema::isValid(const FwJSON::Node* node) const
+{
+    try
+    {
+        validate(node);
+    }
+    catch(const FwJSON::Exception&)
+    {
+        return false;
+    }
+    return true;
+}
+
+bool FwJSON::Schema::isValid(const QByteArray& utf8String) const
+{
+    try
+    {
+        validate(utf8String);
+    }
+    catch(const FwJSON::Exception&)
+    {
+        return false;
+    }
+    return true;
+}
+
+int FwJSON::Schema::compile(const FwJSON::Object& schema)
+{
+    //Nested schemas are appended while the rule is filled, so it is
+    //stored at the reserved index at the end
+    int index = m_rules.size();
+    m_rules.append(Rule());
+
+    Rule rule;
+    rule.types = 0;
+    rule.integer = false;
+    if(const FwJSON::Node* type = schema.attribute("type"))
+    {
+        QVector<const FwJSON::Node*> names;
+        if(const FwJSON::Array* array = FwJSON::cast<FwJSON::Array>(type))
+        {
+            for(const FwJSON::Node* item : *array)
+            {
+                names.append(item);
+            }
+        }
+        else
+        {
+            names.append(type);
+        }
+
+        bool number = false;
+        foreach(const FwJSON::Node* name, names)
+        {
+            const FwJSON::String* string = FwJSON::cast<FwJSON::String>(name);
+            QByteArray typeName = string ? string->value().toUtf8() : QByteArray();
+            if(typeName == "null")
+            {
+                rule.types |= typeBit(FwJSON::Type::Null);
+            }
+            else if(typeName == "boolean")
+            {
+                rule.types |= typeBit(FwJSON::Type::Bool);
+            }
+            else if(typeName == "number")
+            {
+                rule.types |= typeBit(FwJSON::Type::Number);
+                number = true;
+            }
+            else if(typeName == "integer")
+            {
+                rule.types |= typeBit(FwJSON::Type::Number);
+                rule.integer = true;
+            }
+            else if(typeName == "string")
+            {
+                rule.types |= typeBit(FwJSON::Type::String);
+            }
+            else if(typeName == "object")
+            {
+                rule.types |= typeBit(FwJSON::Type::Object);
+            }
+            else if(typeName == "array")
+            {
+                rule.types |= typeBit(FwJSON::Type::Array);
+            }
+            else
+            {
+                throw FwJSON::Exception("Schema has unknown type: " + name->toUtf8());
+            }
+        }
+        rule.integer = rule.integer && !number;
+    }
+
+    rule.minimum = numberKeyword(schema, "minimum", -std::numeric_limits<double>::infinity());
+    rule.maximum = numberKeyword(schema, "maximum", std::numeric_limits<double>::infinity());
+    rule.minLength = lengthKeyword(schema, "minLength", 0);
+    rule.maxLength = lengthKeyword(schema, "maxLength", INT_MAX);
+    rule.minItems = lengthKeyword(schema, "minItems", 0);
+    rule.maxItems = lengthKeyword(schema, "maxItems", INT_MAX);
+
+    if(const FwJSON::Node* pattern = schema.attribute("pattern"))
+    {
+        const FwJSON::String* string = FwJSON::cast<FwJSON::String>(pattern);
+        if(!string)
+        {
+            throw FwJSON::Exception("Schema keyword \"pattern\" is not a string");
+        }
+        rule.pattern.setPattern(stringText(string));
+        if(!rule.pattern.isValid())
+        {
+            throw FwJSON::Exception("Schema has invalid pattern: " + string->value().toUtf8());
+        }
+        rule.pattern.optimize();
+    }
+
+    if(const FwJSON::Node* values = schema.attribute("enum"))
+    {
+        const FwJSON::Array* array = FwJSON::cast<FwJSON::Array>(values);
+        if(!array)
+        {
+            throw FwJSON::Exception("Schema keyword \"enum\" is not an array");
+        }
+        QScopedPointer<FwJSON::Node> temporary;
+        for(int i = 0; i < array->size(); i++)
+        {
+            const FwJSON::Node* item = array->itemView(i, &temporary);
+            Value value;
+            value.type = item->type();
+            value.number = 0.;
+            switch(item->type())
+            {
+            case FwJSON::Type::Number:
+                value.number = static_cast<const FwJSON::Number*>(item)->value();
+                break;
+
+            case FwJSON::Type::String:
+                value.string = stringText(static_cast<const FwJSON::String*>(item));
+                break;
+
+            case FwJSON::Type::Bool:
+                value.number = static_cast<const FwJSON::Boolean*>(item)->value() ? 1. : 0.;
+                break;
+
+            case FwJSON::Type::Null:
+                break;
+
+            default:
+                throw FwJSON::Exception("Schema keyword \"enum\" supports only scalar values");
+            }
+            rule.values.append(value);
+        }
+    }
+
+    if(const FwJSON::Node* properties = schema.attribute("properties"))
+    {
+        const FwJSON::Object* object = FwJSON::cast<FwJSON::Object>(properties);
+        if(!object)
+        {
+            throw FwJSON::Exception("Schema keyword \"properties\" is not an object");
+        }
+        for(const FwJSON::Attribute& attribute : *object)
+        {
+            const FwJSON::Object* subschema = FwJSON::cast<FwJSON::Object>(attribute.value);
+            if(!subschema)
+            {
+                throw FwJSON::Exception("Schema of property \"" + attribute.name + "\" is not an object");
+            }
+
+            Property property;
+            property.name = attribute.name;
+            property.hash = FwJSON::hashName(attribute.name.constData(), attribute.name.size());
+            property.rule = compile(*subschema);
+            property.required = false;
+            rule.properties.append(property);
+        }
+    }
+
+    rule.required = 0;
+    if(const FwJSON::Node* required = schema.attribute("required"))
+    {
+        const FwJSON::Array* array = FwJSON::cast<FwJSON::Array>(required);
+        if(!array)
+        {
+            throw FwJSON::Exception("Schema keyword \"required\" is not an array");
+        }
+        for(const FwJSON::Node* item : *array)
+        {
+            const FwJSON::String* string = FwJSON::cast<FwJSON::String>(item);
+            if(!string)
+            {
+                throw FwJSON::Exception("Schema keyword \"required\" is not an array of strings");
+            }
+
+            QByteArray name = string->value().toUtf8();
+            int i = property(rule, name.constData(), name.size(), 0);
+            if(i < 0)
+            {
+                Property property;
+                property.name = name;
+                property.hash = FwJSON::hashName(name.constData(), name.size());
+                property.rule = -1;
+                property.required = true;
+                rule.properties.append(property);
+                rule.required++;
+            }
+            else if(!rule.properties.at(i).required)
+            {
+                rule.properties[i].required = true;
+                rule.required++;
+            }
+        }
+    }
+
+    rule.items = -1;
+    if(const FwJSON::Node* items = schema.attribute("items"))
+    {
+        const FwJSON::Object* subschema = FwJSON::cast<FwJSON::Object>(items);
+        if(!subschema)
+        {
+            throw FwJSON::Exception("Schema keyword \"items\" is not an object, tuples are not supported");
+        }
+        rule.items = compile(*subschema);
+    }
+
+    m_rules[index] = rule;
+    return index;
+}
+
+int FwJSON::Schema::property(const FwJSON::Schema::Rule& rule, const char* name, int size, int next)
+{
+    //Attributes usually follow the order of the properties, see
+    //FwJSON::Reader::findField()
+    const QVector<Property>& properties = rule.properties;
+    if(next < properties.size() &&
+       properties.at(next).name.size() == size &&
+       memcmp(properties.at(next).name.constData(), name, size) == 0)
+    {
+        return next;
+    }
+
+    uint hash = FwJSON::hashName(name, size);
+    for(int i = 0; i < properties.size(); i++)
+    {
+        const Property& property = properties.at(i);
+        if(property.hash == hash && property.name.size() == size && memcmp(property.name.constData(), name, size) == 0)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void FwJSON::Schema::check(int index, const FwJSON::Node* node, const Frame* frame) const
+{
+    const Rule& rule = m_rules.at(index);
+    QByteArray error = checkType(rule, node->type());
+    if(!error.isEmpty())
+    {
+        throw FwJSON::Exception(violation(frame, error));
+    }
+
+    switch(node->type())
+    {
+    case FwJSON::Type::Object:
+        {
+            const FwJSON::Object* object = static_cast<const FwJSON::Object*>(node);
+            QBitArray found;
+            if(rule.required > 0)
+            {
+                found.resize(rule.properties.size());
+            }
+
+            int next = 0;
+            for(const FwJSON::Attribute& attribute : *object)
+            {
+                int i = property(rule, attribute.name.constData(), attribute.name.size(), next);
+                if(i < 0)
+                {
+                    continue;
+                }
+
+                next = i + 1;
+                const Property& property = rule.properties.at(i);
+                if(property.required)
+                {
+                    found.setBit(i);
+                }
+                if(property.rule >= 0)
+                {
+                    Frame child = { frame, property.name.constData(), property.name.size(), -1 };
+                    check(property.rule, attribute.value, &child);
+                }
+            }
+
+            if(rule.required > 0 && found.count(true) < rule.required)
+            {
+                for(int i = 0; i < rule.properties.size(); i++)
+                {
+                    if(rule.properties.at(i).required && !found.testBit(i))
+                    {
+                        error = "Required property \"" + rule.properties.at(i).name + "\" is missing";
+                        break;
+                    }
+                }
+            }
+        }
+        break;
+
+    case FwJSON::Type::Array:
+        {
+            const FwJSON::Array* array = static_cast<const FwJSON::Array*>(node);
+            if(array->size() < rule.minItems)
+            {
+                error = "Array has fewer items than minItems";
+            }
+            else if(array->size() > rule.maxItems)
+            {
+                error = "Array has more items than maxItems";
+            }
+            else if(rule.items >= 0 && array->isPacked())
+            {
+                //Packed numbers are checked without creating nodes
+                const Rule& items = m_rules.at(rule.items);
+                const QVector<double>& numbers = array->numbers();
+                for(int i = 0; i < numbers.size(); i++)
+                {
+                    QByteArray itemError = checkType(items, FwJSON::Type::Number);
+                    if(itemError.isEmpty())
+                    {
+                        itemError = checkValue(items, FwJSON::Type::Number, numbers.at(i), QString());
+                    }
+                    if(!itemError.isEmpty())
+                    {
+                        Frame child = { frame, nullptr, 0, i };
+                        throw FwJSON::Exception(violation(&child, itemError));
+                    }
+                }
+            }
+            else if(rule.items >= 0)
+            {
+                //Rows of a columnar array are built one at a time
+                QScopedPointer<FwJSON::Node> item;
+                for(int i = 0; i < array->size(); i++)
+                {
+                    Frame child = { frame, nullptr, 0, i };
+                    check(rule.items, array->itemView(i, &item), &child);
+                }
+            }
+        }
+        break;
+
+    case FwJSON::Type::Number:
+        error = checkValue(rule, FwJSON::Type::Number, static_cast<const FwJSON::Number*>(node)->value(), QString());
+        break;
+
+    case FwJSON::Type::String:
+        error = checkValue(rule, FwJSON::Type::String, 0., stringText(static_cast<const FwJSON::String*>(node)));
+        break;
+
+    case FwJSON::Type::Bool:
+        error = checkValue(rule, FwJSON::Type::Bool, static_cast<const FwJSON::Boolean*>(node)->value() ? 1. : 0., QString());
+        break;
+
+    case FwJSON::Type::Null:
+        error = checkValue(rule, FwJSON::Type::Null, 0., QString());
+        break;
+    }
+
+    if(!error.isEmpty())
+    {
+        throw FwJSON::Exception(violation(frame, error));
+    }
+}
+
+void FwJSON::Schema::check(int index, FwJSON::Reader* reader, const Frame* frame) const
+{
+    const Rule& rule = m_rules.at(index);
+    FwJSON::Type type = reader->peek();
+
+    //Errors are reported at the beginning of the value
+    const char* begin = reader->m_current;
+    QByteArray error = checkType(rule, type);
+    if(!error.isEmpty())
+    {
+        reader->fail(violation(frame, error));
+    }
+
+    switch(type)
+    {
+    case FwJSON::Type::Object:
+        {
+            QBitArray found;
+            if(rule.required > 0)
+            {
+                found.resize(rule.properties.size());
+            }
+
+            int next = 0;
+            const char* name = nullptr;
+            int size = 0;
+            reader->beginObject();
+            while(reader->nextAttribute(&name, &size))
+            {
+                int i = property(rule, name, size, next);
+                if(i < 0)
+                {
+                    reader->skipValue();
+                    continue;
+                }
+
+                next = i + 1;
+                const Property& property = rule.properties.at(i);
+                if(property.required)
+                {
+                    found.setBit(i);
+                }
+                if(property.rule >= 0)
+                {
+                    Frame child = { frame, property.name.constData(), property.name.size(), -1 };
+                    check(property.rule, reader, &child);
+                }
+                else
+                {
+                    reader->skipValue();
+                }
+            }
+
+            if(rule.required > 0 && found.count(true) < rule.required)
+            {
+                for(int i = 0; i < rule.properties.size(); i++)
+                {
+                    if(rule.properties.at(i).required && !found.testBit(i))
+                    {
+                        error = "Required property \"" + rule.properties.at(i).name + "\" is missing";
+                        break;
+                    }
+                }
+            }
+        }
+        break;
+
+    case FwJSON::Type::Array:
+        {
+            int count = 0;
+            reader->beginArray();
+            while(reader->nextItem())
+            {
+                if(count == rule.maxItems)
+                {
+                    reader->m_current = begin;
+                    reader->fail(violation(frame, "Array has more items than maxItems"));
+                }
+
+                if(rule.items >= 0)
+                {
+                    Frame child = { frame, nullptr, 0, count };
+                    check(rule.items, reader, &child);
+                }
+                else
+                {
+                    reader->skipValue();
+                }
+                count++;
+            }
+            if(count < rule.minItems)
+            {
+                error = "Array has fewer items than minItems";
+            }
+        }
+        break;
+
+    case FwJSON::Type::Number:
+        {
+            double value = 0.;
+            reader->read(&value);
+            error = checkValue(rule, FwJSON::Type::Number, value, QString());
+        }
+        break;
+
+    case FwJSON::Type::String:
+        {
+            QString value;
+            reader->read(&value);
+            error = checkValue(rule, FwJSON::Type::String, 0., value);
+        }
+        break;
+
+    case FwJSON::Type::Bool:
+        {
+            bool value = false;
+            reader->read(&value);
+            error = checkValue(rule, FwJSON::Type::Bool, value ? 1. : 0., QString());
+        }
+        break;
+
+    case FwJSON::Type::Null:
+        reader->readNull();
+        error = checkValue(rule, FwJSON::Type::Null, 0., QString());
+        break;
+    }
+
+    if(!error.isEmpty())
+    {
+        reader->m_current = begin;
+        reader->fail(violation(frame, error));
+    }
+}
+
+QByteArray FwJSON::Schema::checkType(const FwJSON::Schema::Rule& rule, FwJSON::Type type)
+{
+    if(rule.types != 0 && (rule.types & typeBit(type)) == 0)
+    {
+        return "Value has unexpected type";
+    }
+    return QByteArray();
+}
+
+QByteArray FwJSON::Schema::checkValue(const FwJSON::Schema::Rule& rule, FwJSON::Type type,
+                                      double number, const QString& string)
+{
+    switch(type)
+    {
+    case FwJSON::Type::Number:
+        if(rule.integer && number != std::floor(number))
+        {
+            return "Number is not an integer";
+        }
+        if(number < rule.minimum)
+        {
+            return "Number is less than minimum";
+        }
+        if(number > rule.maximum)
+        {
+            return "Number is greater than maximum";
+        }
+        break;
+
+    case FwJSON::Type::String:
+        if(string.size() < rule.minLength)
+        {
+            return "String is shorter than minLength";
+        }
+        if(string.size() > rule.maxLength)
+        {
+            return "String is longer than maxLength";
+        }
+        if(!rule.pattern.pattern().isEmpty() && !rule.pattern.match(string).hasMatch())
+        {
+            return "String does not match pattern";
+        }
+        break;
+
+    default:
+        break;
+    }
+
+    if(rule.values.isEmpty())
+    {
+        return QByteArray();
+    }
+    foreach(const Value& value, rule.values)
+    {
+        if(value.type == type && value.number == number && value.string == string)
+        {
+            return QByteArray();
+        }
+    }
+    return "Value is not one of enum";
+}
+
+QByteArray FwJSON::Schema::violation(const Frame* frame, const QByteArray& error)
+{
+    //JSON Pointer (RFC 6901) of the value
+    QList<QByteArray> tokens;
+    for(; frame; frame = frame->parent)
+    {
+        if(frame->index >= 0)
+        {
+            tokens.prepend(QByteArray::number(frame->index));
+        }
+        else
+        {
+            QByteArray name(frame->name, frame->size);
+            tokens.prepend(name.replace('~', "~0").replace('/', "~1"));
+        }
+    }
+
+    QByteArray pointer;
+    foreach(const QByteArray& token, tokens)
+    {
+        pointer += "/" + token;
+    }
+    return error + " at \"" + pointer + "\"";
+}
@@ -0,0 +1,327 @@
+#include <cstdio>
+#include <cstring>
+
+#include <QtCore/qiodevice.h>
+#include <QtCore/qnumeric.h>
+
+#include "fwjsonwriter.h"
+#include "fwjson.h"
+
+namespace
+{
+    //Characters which have to be escaped in JSON strings
+    inline bool isSpecial(quint8 c)
+    {
+        return c < 0x20 || c == '"' || c == '\\';
+    }
+}
+
+FwJSON::Writer::Writer(QByteArray* buffer) :
+    m_buffer(buffer),
+    m_device(nullptr),
+    m_blockSize(0),
+    m_offset(-buffer->size()),
+    m_first(true),
+    m_afterKey(false)
+{
+}
+
+FwJSON::Writer::Writer(QIODevice* device, int blockSize) :
+    m_buffer(&m_block),
+    m_device(device),
+    m_blockSize(blockSize),
+    m_offset(0),
+    m_first(true),
+    m_afterKey(false)
+{
+    m_block.reserve(blockSize);
+}
+
+FwJSON::Writer::~Writer()
+{
+    try
+    {
+        flush();
+    }
+    catch(const FwJSON::Exception&)
+    {
+    }
+}
+
+void FwJSON::Writer::flush()
+{
+    if(!m_device || m_block.isEmpty())
+    {
+        return;
+    }
+
+    if(!m_device->isOpen() && !m_device->open(QIODevice::WriteOnly))
+    {
+        throw FwJSON::Exception(m_device->errorString().toUtf8());
+    }
+
+    qint64 written = m_device->write(m_block);
+    m_offset += m_block.size();
+    m_block.resize(0);
+    if(written < 0)
+    {
+        throw FwJSON::Exception(m_device->errorString().toUtf8());
+    }
+}
+
+void FwJSON::Writer::write(bool value)
+{
+    if(value)
+    {
+        writeRaw("true", 4);
+    }
+    else
+    {
+        writeRaw("false", 5);
+    }
+}
+
+void FwJSON::Writer::write(int value)
+{
+    writeInteger(value < 0 ? 0u - static_cast<quint64>(value) : static_cast<quint64>(value), value < 0);
+}
+
+void FwJSON::Writer::write(uint value)
+{
+    writeInteger(value, false);
+}
+
+void FwJSON::Writer::write(qint64 value)
+{
+    writeInteger(value < 0 ? 0u - static_cast<quint64>(value) : static_cast<quint64>(value), value < 0);
+}
+
+void FwJSON::Writer::write(double value)
+{
+    //JSON has no infinities and NaN
+    if(!qIsFinite(value))
+    {
+        writeNull();
+        return;
+    }
+
+    //The fewest of 15, 16 and 17 significant digits which read back as
+    //the same double, 17 always do
+    char number[32];
+    int size = 0;
+    for(int precision = 15; precision <= 17; precision++)
+    {
+        size = std::snprintf(number, sizeof(number), "%.*g", precision, value);
+
+        //printf() follows the locale of the process
+        if(char* point = static_cast<char*>(memchr(number, ',', size)))
+        {
+            *point = '.';
+        }
+        if(QByteArray::fromRawData(number, size).toDouble() == value)
+        {
+            break;
+        }
+    }
+    writeRaw(number, size);
+}
+
+void FwJSON::Writer::write(const QString& value)
+{
+    QByteArray utf8 = value.toUtf8();
+    writeEscaped(utf8.constData(), utf8.size());
+}
+
+void FwJSON::Writer::write(const QByteArray& value)
+{
+    writeEscaped(value.constData(), value.size());
+}
+
+void FwJSON::Writer::writeNull()
+{
+    writeRaw("null", 4);
+}
+
+void FwJSON::Writer::writeInteger(quint64 value, bool negative)
+{
+    //Digits are written from the end of the stack buffer
+    char digits[21];
+    char* c_ptr = digits + sizeof(digits);
+    do
+    {
+        *(--c_ptr) = static_cast<char>('0' + value % 10);
+        value /= 10;
+    }
+    while(value > 0);
+    if(negative)
+    {
+        *(--c_ptr) = '-';
+    }
+    writeRaw(c_ptr, static_cast<int>(digits + sizeof(digits) - c_ptr));
+}
+
+void FwJSON::Writer::writeEscaped(const char* data, int size)
+{
+    static const char hexDigits[] = "0123456789abcdef";
+
+    writeRaw('"');
+    const char* end = data + size;
+    const char* run = data;
+    for(const char* c_ptr = data; c_ptr < end; c_ptr++)
+    {
+        quint8 c = static_cast<quint8>(*c_ptr);
+        if(!isSpecial(c))
+        {
+            continue;
+        }
+
+        //Characters without escapes are appended at once
+        writeRaw(run, static_cast<int>(c_ptr - run));
+        run = c_ptr + 1;
+        switch(c)
+        {
+        case '"':
+            writeRaw("\\\"", 2);
+            break;
+
+        case '\\':
+            writeRaw("\\\\", 2);
+            break;
+
+        case '\b':
+            writeRaw("\\b", 2);
+            break;
+
+        case '\f':
+            writeRaw("\\f", 2);
+            break;
+
+        case '\n':
+            writeRaw("\\n", 2);
+            break;
+
+        case '\r':
+            writeRaw("\\r", 2);
+            break;
+
+        case '\t':
+            writeRaw("\\t", 2);
+            break;
+
+        default:
+            {
+                const char escape[] = { '\\', 'u', '0', '0', hexDigits[c >> 4], hexDigits[c & 0xF] };
+                writeRaw(escape, sizeof(escape));
+            }
+            break;
+        }
+    }
+    writeRaw(run, static_cast<int>(end - run));
+    writeRaw('"');
+}
+
+void FwJSON::Writer::separate()
+{
+#ifndef QT_NO_DEBUG
+    //One root value, attributes of objects need keys
+    Q_ASSERT(!m_nesting.isEmpty() || m_first);
+    Q_ASSERT(m_nesting.isEmpty() || !m_nesting.endsWith('{') || m_afterKey);
+#endif
+
+    if(m_afterKey)
+    {
+        m_afterKey = false;
+        return;
+    }
+    if(!m_first)
+    {
+        writeRaw(',');
+    }
+    m_first = false;
+}
+
+void FwJSON::Writer::beginObject()
+{
+    separate();
+    writeRaw('{');
+    m_first = true;
+#ifndef QT_NO_DEBUG
+    m_nesting.append('{');
+#endif
+}
+
+void FwJSON::Writer::endObject()
+{
+#ifndef QT_NO_DEBUG
+    Q_ASSERT(m_nesting.endsWith('{') && !m_afterKey);
+    m_nesting.chop(1);
+#endif
+    writeRaw('}');
+    m_first = false;
+}
+
+void FwJSON::Writer::beginArray()
+{
+    separate();
+    writeRaw('[');
+    m_first = true;
+#ifndef QT_NO_DEBUG
+    m_nesting.append('[');
+#endif
+}
+
+void FwJSON::Writer::endArray()
+{
+#ifndef QT_NO_DEBUG
+    Q_ASSERT(m_nesting.endsWith('['));
+    m_nesting.chop(1);
+#endif
+    writeRaw(']');
+    m_first = false;
+}
+
+void FwJSON::Writer::key(const char* name)
+{
+    key(QByteArray::fromRawData(name, static_cast<int>(strlen(name))));
+}
+
+void FwJSON::Writer::key(const QByteArray& name)
+{
+#ifndef QT_NO_DEBUG
+    Q_ASSERT(m_nesting.endsWith('{') && !m_afterKey);
+#endif
+
+    if(!m_first)
+    {
+        writeRaw(',');
+    }
+    m_first = false;
+    writeEscaped(name.constData(), name.size());
+    writeRaw(':');
+    m_afterKey = true;
+}
+
+void FwJSON::Writer::value(const char* value)
+{
+    separate();
+    writeEscaped(value, static_cast<int>(strlen(value)));
+}
+
+void FwJSON::Writer::nullValue()
+{
+    separate();
+    writeNull();
+}
+
+void FwJSON::Writer::nodeValue(const FwJSON::Node* node)
+{
+    separate();
+    qint64 begin = size();
+    node->write(this);
+
+    //Only empty arrays and arrays of them write nothing
+    if(size() == begin)
+    {
+        writeRaw("[]", 2);
+    }
+}
@@ -0,0 +1,24 @@
+QT       += core
+
+QT       -= gui
+
+win32 {
+   TARGET = ../../../bin/fwjsontest
+}
+else {
+   TARGET = ../../bin/fwjsontest
+}
+
+CONFIG   += console
+CONFIG   -= app_bundle
+
+TEMPLATE = app
+
+INCLUDEPATH += ../../include \
+               ../../src
+
+LIBS += \
+      -L../../bin \
+      -lfwjson1
+
+SOURCES += main.cpp
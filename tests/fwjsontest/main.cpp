@@ -0,0 +1,750 @@
+/******************************************************************************
+
+Copyright (c) 2012 Egor Popov <garlero@yandex.ru>
+
+Permission is hereby granted, free of charge, to any person obtaining a 
+copy of this software and associated documentation files (the "Software"), 
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom 
+the Software is furnished to do so, subject to the following conditions:
+    
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH
+THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+******************************************************************************/
+
+#include <climits>
+
+#include <QtCore/qcoreapplication.h>
+#include <QtCore/qbytearray.h>
+#include <QtCore/qdebug.h>
+#include <QtCore/qnumeric.h>
+
+#include "fwjson.h"
+#include "fwjsonbinding.h"
+#include "fwjsonpatch.h"
+#include "fwjsonpath.h"
+#include "fwjsonschema.h"
+
+struct Reading
+{
+    int id;
+    uint flags;
+    qint64 stamp;
+    double value;
+    bool valid;
+    QString name;
+    QByteArray raw;
+    QVector<int> samples;
+};
+
+FWJSON_BINDING(Reading, FWJSON_FIELD(id), FWJSON_FIELD(flags), FWJSON_FIELD(stamp), FWJSON_FIELD(value),
+               FWJSON_FIELD(valid), FWJSON_FIELD(name), FWJSON_FIELD(raw), FWJSON_FIELD(samples))
+
+namespace
+{
+    int failures = 0;
+
+    void check(bool condition, const char* expression, int line)
+    {
+        if(!condition)
+        {
+            qWarning() << "FAIL line" << line << ":" << expression;
+            failures++;
+        }
+    }
+
+    //Applies the patch to the document, expected is nullptr if the patch
+    //has to fail
+    bool patched(const char* document, const char* patch, const char* expected)
+    {
+        FwJSON::Object root;
+        root.parse(document);
+        FwJSON::Object operations;
+        operations.parse(QByteArray("{\"patch\":") + patch + "}");
+        try
+        {
+            FwJSON::applyPatch(&root, *FwJSON::cast<FwJSON::Array>(operations.attribute("patch")));
+        }
+        catch(const FwJSON::Exception&)
+        {
+            return !expected;
+        }
+
+        FwJSON::Object result;
+        result.parse(expected);
+        return expected && root.equals(&result);
+    }
+
+    bool merged(const char* document, const char* patch, const char* expected)
+    {
+        FwJSON::Object root;
+        root.parse(document);
+        FwJSON::Object object;
+        object.parse(patch);
+        root.mergePatch(object);
+
+        FwJSON::Object result;
+        result.parse(expected);
+        return root.equals(&result);
+    }
+
+    bool readFails(const QByteArray& utf8String)
+    {
+        try
+        {
+            Reading reading;
+            FwJSON::read(utf8String, &reading);
+        }
+        catch(const FwJSON::Exception&)
+        {
+            return true;
+        }
+        return false;
+    }
+
+    bool parseFails(const QByteArray& utf8String)
+    {
+        try
+        {
+            FwJSON::Object object;
+            object.parse(utf8String);
+        }
+        catch(const FwJSON::Exception&)
+        {
+            return true;
+        }
+        return false;
+    }
+
+    //Reads the attribute without giving a copy its own children
+    const FwJSON::Node* constAttribute(const FwJSON::Node* node, const char* name)
+    {
+        return FwJSON::cast<FwJSON::Object>(node)->attribute(name);
+    }
+}
+
+#define CHECK(condition) check((condition), #condition, __LINE__)
+
+static void testParse()
+{
+    //Line breaks are spaces between tokens only
+    CHECK(parseFails("{\"a\":\"x\ny\"}"));
+    CHECK(parseFails("{\"a\":\"x\ry\"}"));
+
+    FwJSON::Object object;
+    object.parse("{\r\n\t\"a\" :\n\"x y\"\r\n}");
+    CHECK(object.value<FwJSON::String>("a") == "x y");
+
+    //Names are predicted from the previous record, other orders fall back
+    const QByteArray records("{\"r\":[{\"ts\":1,\"id\":\"a\"},{\"ts\":2,\"id\":\"b\"},{\"id\":\"c\",\"ts\":3,\"ts\":4}]}");
+    FwJSON::Object root;
+    root.parse(records);
+    FwJSON::Object* record = FwJSON::cast<FwJSON::Object>(FwJSON::cast<FwJSON::Array>(root.attribute("r"))->item(2));
+    CHECK(record->attributesCount() == 2);
+    CHECK(record->value<FwJSON::Number>("ts") == 4 && record->value<FwJSON::String>("id") == "c");
+    CHECK(root.toUtf8() == "{\"r\":[{\"ts\":1,\"id\":\"a\"},{\"ts\":2,\"id\":\"b\"},{\"id\":\"c\",\"ts\":4}]}");
+}
+
+static void testClone()
+{
+    const QByteArray utf8("{\"a\":{\"x\":1},\"n\":2,\"l\":[1,2,3]}");
+    FwJSON::Object root;
+    root.parse(utf8);
+
+    //Nodes taken before cloning stay out of the copy
+    FwJSON::Object* a = FwJSON::cast<FwJSON::Object>(root.attribute("a"));
+    FwJSON::Number* n = FwJSON::cast<FwJSON::Number>(root.attribute("n"));
+    FwJSON::Node* copy = root.clone();
+    a->setValue<FwJSON::Number>("x", 42);
+    n->setValue(5);
+    CHECK(copy->toUtf8() == utf8);
+    CHECK(root.toUtf8() == "{\"a\":{\"x\":42},\"n\":5,\"l\":[1,2,3]}");
+
+    //Changes of the copy do not reach the source
+    FwJSON::Object* object = FwJSON::cast<FwJSON::Object>(copy);
+    FwJSON::cast<FwJSON::Object>(object->attribute("a"))->addNumber("y", 1);
+    object->removeAttribute("n");
+    CHECK(root.toUtf8() == "{\"a\":{\"x\":42},\"n\":5,\"l\":[1,2,3]}");
+    CHECK(object->attribute("a")->parent() == object);
+    delete copy;
+
+    //Packed numbers are shared by the copies until one of them changes
+    FwJSON::Array* list = FwJSON::cast<FwJSON::Array>(root.attribute("l"));
+    CHECK(list->pack());
+    FwJSON::Array* listCopy = FwJSON::cast<FwJSON::Array>(list->clone());
+    listCopy->appendNumber(4);
+    CHECK(list->toUtf8() == "[1,2,3]");
+    CHECK(listCopy->toUtf8() == "[1,2,3,4]");
+    delete listCopy;
+
+    FwJSON::Array records;
+    records.addObject()->addNumber("id", 1);
+    records.addObject()->addNumber("id", 2);
+    CHECK(records.toColumnar());
+    FwJSON::Node* recordsCopy = records.clone();
+    FwJSON::cast<FwJSON::Object>(FwJSON::cast<FwJSON::Array>(recordsCopy)->item(0))->setValue<FwJSON::Number>("id", 7);
+    CHECK(records.toUtf8() == "[{\"id\":1},{\"id\":2}]");
+    CHECK(recordsCopy->toUtf8() == "[{\"id\":7},{\"id\":2}]");
+    delete recordsCopy;
+
+    //Copies of a frozen template share the nodes until they change them
+    FwJSON::Object frozen;
+    frozen.parse("{\"a\":{\"x\":1,\"y\":{\"z\":2}},\"b\":{\"w\":3},\"l\":[1,[2]]}");
+    frozen.freeze();
+    const FwJSON::Object* b = FwJSON::cast<FwJSON::Object>(frozen.attribute("b"));
+    QScopedPointer<FwJSON::Object> shared(FwJSON::cast<FwJSON::Object>(frozen.clone()));
+    const FwJSON::Object* sharedView = shared.data();
+    CHECK(sharedView->attribute("b") == b);
+    CHECK(sharedView->value<FwJSON::Number>("a", 0) == 0);
+    CHECK(shared->equals(&frozen) && shared->hash() == frozen.hash());
+
+    //Only the objects on the way to the changed value are copied
+    FwJSON::Object* sharedA = FwJSON::cast<FwJSON::Object>(shared->attribute("a"));
+    CHECK(sharedA != frozen.attribute("a") && sharedA->parent() == shared.data());
+    sharedA->setValue<FwJSON::Number>("x", 5);
+    CHECK(constAttribute(constAttribute(sharedA, "y"), "z") ==
+          constAttribute(constAttribute(constAttribute(&frozen, "a"), "y"), "z"));
+    CHECK(constAttribute(sharedView->attribute("b"), "w") == b->attribute("w"));
+    FwJSON::cast<FwJSON::Array>(shared->attribute("l"))->addNumber(3);
+    CHECK(shared->toUtf8() == "{\"a\":{\"x\":5,\"y\":{\"z\":2}},\"b\":{\"w\":3},\"l\":[1,[2],3]}");
+    CHECK(frozen.toUtf8() == "{\"a\":{\"x\":1,\"y\":{\"z\":2}},\"b\":{\"w\":3},\"l\":[1,[2]]}");
+
+    //Copies of the copy share the frozen nodes too
+    QScopedPointer<FwJSON::Node> second(shared->clone());
+    CHECK(FwJSON::cast<FwJSON::Object>(second.data())->attribute("b") != b);
+    CHECK(static_cast<const FwJSON::Object*>(second.data())->attribute("a") != sharedA);
+    FwJSON::Object patch;
+    patch.parse("{\"b\":{\"w\":null,\"v\":4}}");
+    FwJSON::cast<FwJSON::Object>(second.data())->mergePatch(patch);
+    CHECK(second->toUtf8() == "{\"a\":{\"x\":5,\"y\":{\"z\":2}},\"b\":{\"v\":4},\"l\":[1,[2],3]}");
+    CHECK(FwJSON::Path("/b/w").first(&frozen) == b->attribute("w"));
+    shared.reset();
+    second.reset();
+    CHECK(frozen.toUtf8() == "{\"a\":{\"x\":1,\"y\":{\"z\":2}},\"b\":{\"w\":3},\"l\":[1,[2]]}");
+}
+
+static void testViews()
+{
+    FwJSON::Object root;
+    root.parse("{\"l\":[1,2,3],\"r\":[{\"id\":1,\"s\":\"a\"},{\"id\":2,\"s\":\"b\"}]}");
+    FwJSON::Array* list = FwJSON::cast<FwJSON::Array>(root.attribute("l"));
+    FwJSON::Array* records = FwJSON::cast<FwJSON::Array>(root.attribute("r"));
+    CHECK(list->pack());
+    CHECK(records->toColumnar());
+
+    //Reading does not unpack the arrays
+    FwJSON::Object other;
+    other.parse("{\"l\":[1,2,4],\"r\":[{\"id\":1,\"s\":\"a\"},{\"id\":3,\"s\":\"b\"}]}");
+    CHECK(!root.equals(&other));
+    QScopedPointer<FwJSON::Array> patch(FwJSON::diff(&root, &other));
+    CHECK(patch->toUtf8() == "[{\"op\":\"replace\",\"path\":\"/l/2\",\"value\":4},"
+                             "{\"op\":\"replace\",\"path\":\"/r/1/id\",\"value\":3}]");
+    CHECK(FwJSON::Path("/r/*/id").count(&root) == 2);
+    CHECK(FwJSON::Path("/l/0:2").statistics(&root).count == 2);
+    CHECK(FwJSON::Path("/r/1/id").statistics(&root).sum == 2);
+
+    FwJSON::Object schema;
+    schema.parse("{\"properties\":{\"r\":{\"items\":{\"required\":[\"id\"]}}}}");
+    CHECK(FwJSON::Schema(schema).isValid(&root));
+    CHECK(list->isPacked());
+    CHECK(records->isColumnar());
+
+    //Unpacked items are equal to the packed ones
+    QScopedPointer<FwJSON::Node> copy(root.clone());
+    FwJSON::cast<FwJSON::Array>(FwJSON::cast<FwJSON::Object>(copy.data())->attribute("l"))->item(0);
+    FwJSON::cast<FwJSON::Array>(FwJSON::cast<FwJSON::Object>(copy.data())->attribute("r"))->item(0);
+    CHECK(copy->equals(&root));
+    CHECK(root.equals(copy.data()));
+}
+
+static void testAggregations()
+{
+    FwJSON::Object root;
+    FwJSON::Array* values = root.addArray("v");
+    for(int i = 0; i <= 30; i++)
+    {
+        values->addNumber(i * 0.1);
+    }
+
+    //Whole arrays and single items fall into the same bins
+    QVector<int> bins = values->histogram(0., 3., 30);
+    CHECK(FwJSON::Path("/v").histogram(&root, 0., 3., 30) == bins);
+    CHECK(FwJSON::Path("/v/*").histogram(&root, 0., 3., 30) == bins);
+    CHECK(values->pack());
+    CHECK(FwJSON::Path("/v/*").histogram(&root, 0., 3., 30) == bins);
+
+    FwJSON::Statistics statistics = FwJSON::Path("/v/10:").statistics(&root);
+    CHECK(statistics.count == 21 && statistics.min == 1. && statistics.max == 3.);
+}
+
+static void testPatch()
+{
+    //Examples of RFC 6902
+    CHECK(patched("{\"foo\":\"bar\"}",
+                  "[{\"op\":\"add\",\"path\":\"/baz\",\"value\":\"qux\"}]",
+                  "{\"baz\":\"qux\",\"foo\":\"bar\"}"));
+    CHECK(patched("{\"foo\":[\"bar\",\"baz\"]}",
+                  "[{\"op\":\"add\",\"path\":\"/foo/1\",\"value\":\"qux\"}]",
+                  "{\"foo\":[\"bar\",\"qux\",\"baz\"]}"));
+    CHECK(patched("{\"baz\":\"qux\",\"foo\":\"bar\"}",
+                  "[{\"op\":\"remove\",\"path\":\"/baz\"}]",
+                  "{\"foo\":\"bar\"}"));
+    CHECK(patched("{\"foo\":[\"bar\",\"qux\",\"baz\"]}",
+                  "[{\"op\":\"remove\",\"path\":\"/foo/1\"}]",
+                  "{\"foo\":[\"bar\",\"baz\"]}"));
+    CHECK(patched("{\"baz\":\"qux\",\"foo\":\"bar\"}",
+                  "[{\"op\":\"replace\",\"path\":\"/baz\",\"value\":\"boo\"}]",
+                  "{\"baz\":\"boo\",\"foo\":\"bar\"}"));
+    CHECK(patched("{\"foo\":{\"bar\":\"baz\",\"waldo\":\"fred\"},\"qux\":{\"corge\":\"grault\"}}",
+                  "[{\"op\":\"move\",\"from\":\"/foo/waldo\",\"path\":\"/qux/thud\"}]",
+                  "{\"foo\":{\"bar\":\"baz\"},\"qux\":{\"corge\":\"grault\",\"thud\":\"fred\"}}"));
+    CHECK(patched("{\"foo\":[\"all\",\"grass\",\"cows\",\"eat\"]}",
+                  "[{\"op\":\"move\",\"from\":\"/foo/1\",\"path\":\"/foo/3\"}]",
+                  "{\"foo\":[\"all\",\"cows\",\"eat\",\"grass\"]}"));
+    CHECK(patched("{\"baz\":\"qux\",\"foo\":[\"a\",2,\"c\"]}",
+                  "[{\"op\":\"test\",\"path\":\"/baz\",\"value\":\"qux\"},"
+                  "{\"op\":\"test\",\"path\":\"/foo/1\",\"value\":2}]",
+                  "{\"baz\":\"qux\",\"foo\":[\"a\",2,\"c\"]}"));
+    CHECK(patched("{\"baz\":\"qux\"}",
+                  "[{\"op\":\"test\",\"path\":\"/baz\",\"value\":\"bar\"}]",
+                  nullptr));
+    CHECK(patched("{\"foo\":\"bar\"}",
+                  "[{\"op\":\"add\",\"path\":\"/child\",\"value\":{\"grandchild\":{}}}]",
+                  "{\"foo\":\"bar\",\"child\":{\"grandchild\":{}}}"));
+    CHECK(patched("{\"foo\":\"bar\"}",
+                  "[{\"op\":\"add\",\"path\":\"/baz/bat\",\"value\":\"qux\"}]",
+                  nullptr));
+    CHECK(patched("{\"/\":9,\"~1\":10}",
+                  "[{\"op\":\"test\",\"path\":\"/~01\",\"value\":10}]",
+                  "{\"/\":9,\"~1\":10}"));
+    CHECK(patched("{\"/\":9,\"~1\":10}",
+                  "[{\"op\":\"test\",\"path\":\"/~01\",\"value\":\"10\"}]",
+                  nullptr));
+    CHECK(patched("{\"foo\":[\"bar\"]}",
+                  "[{\"op\":\"add\",\"path\":\"/foo/-\",\"value\":[\"abc\",\"def\"]}]",
+                  "{\"foo\":[\"bar\",[\"abc\",\"def\"]]}"));
+
+    //Indexes with leading zeros or signs are not indexes
+    CHECK(patched("{\"foo\":[1,2]}", "[{\"op\":\"remove\",\"path\":\"/foo/01\"}]", nullptr));
+    CHECK(patched("{\"foo\":[1,2]}", "[{\"op\":\"remove\",\"path\":\"/foo/+1\"}]", nullptr));
+    CHECK(patched("{\"foo\":[1,2]}", "[{\"op\":\"remove\",\"path\":\"/foo/-1\"}]", nullptr));
+    FwJSON::Object list;
+    list.parse("{\"foo\":[1,2]}");
+    CHECK(FwJSON::Path("/foo/01").count(&list) == 0);
+    CHECK(FwJSON::Path("/foo/1").count(&list) == 1);
+
+    //The root is replaced in place
+    CHECK(patched("{\"a\":1}", "[{\"op\":\"replace\",\"path\":\"\",\"value\":{\"b\":[1,2]}}]",
+                  "{\"b\":[1,2]}"));
+
+    //Applying the difference gives the target, the inputs stay as they are
+    FwJSON::Object source;
+    source.parse("{\"a\":[1,2,3,4],\"b\":{\"c\":\"d\",\"e\":true},\"f\":[{\"g\":1},{\"g\":2}]}");
+    FwJSON::Object target;
+    target.parse("{\"a\":[1,5,3],\"b\":{\"c\":\"x\"},\"f\":[{\"g\":1},{\"g\":3}],\"h\":null}");
+    FwJSON::cast<FwJSON::Array>(source.attribute("a"))->pack();
+    FwJSON::cast<FwJSON::Array>(target.attribute("f"))->toColumnar();
+    QScopedPointer<FwJSON::Array> patch(FwJSON::diff(&source, &target));
+    CHECK(FwJSON::cast<FwJSON::Array>(source.attribute("a"))->isPacked());
+    CHECK(FwJSON::cast<FwJSON::Array>(target.attribute("f"))->isColumnar());
+    FwJSON::applyPatch(&source, *patch);
+    CHECK(source.equals(&target));
+
+    //Paths hold the text of names with escapes
+    FwJSON::Object escapedSource;
+    escapedSource.parse("{\"a\\\"b\":1,\"c\":{\"d\\te\":2}}");
+    FwJSON::Object escapedTarget;
+    escapedTarget.parse("{\"a\\\"b\":2,\"c\":{\"d\\te\":3},\"n\\\"w\":4}");
+    patch.reset(FwJSON::diff(&escapedSource, &escapedTarget));
+    CHECK(patch->toUtf8() == "[{\"op\":\"replace\",\"path\":\"/a\\\"b\",\"value\":2},"
+                             "{\"op\":\"replace\",\"path\":\"/c/d\\te\",\"value\":3},"
+                             "{\"op\":\"add\",\"path\":\"/n\\\"w\",\"value\":4}]");
+    FwJSON::applyPatch(&escapedSource, *patch);
+    CHECK(escapedSource.equals(&escapedTarget));
+
+    //A failed move puts the value back
+    CHECK(patched("{\"a\":{\"b\":1},\"l\":[1,2]}",
+                  "[{\"op\":\"move\",\"from\":\"/l/0\",\"path\":\"/l/5\"}]",
+                  nullptr));
+    FwJSON::Object moved;
+    moved.parse("{\"a\":{\"b\":1},\"l\":[1,2]}");
+    FwJSON::Object operations;
+    operations.parse("{\"l\":[{\"op\":\"move\",\"from\":\"/l/0\",\"path\":\"/l/5\"}],"
+                     "\"a\":[{\"op\":\"move\",\"from\":\"/a/b\",\"path\":\"/x/y\"}]}");
+    for(const FwJSON::Attribute& attribute : operations)
+    {
+        try
+        {
+            FwJSON::applyPatch(&moved, *FwJSON::cast<FwJSON::Array>(attribute.value));
+            CHECK(false);
+        }
+        catch(const FwJSON::Exception&)
+        {
+        }
+    }
+    CHECK(moved.toUtf8() == "{\"a\":{\"b\":1},\"l\":[1,2]}");
+
+    //Examples of RFC 7386 with object targets and patches
+    CHECK(merged("{\"a\":\"b\"}", "{\"a\":\"c\"}", "{\"a\":\"c\"}"));
+    CHECK(merged("{\"a\":\"b\"}", "{\"b\":\"c\"}", "{\"a\":\"b\",\"b\":\"c\"}"));
+    CHECK(merged("{\"a\":\"b\"}", "{\"a\":null}", "{}"));
+    CHECK(merged("{\"a\":\"b\",\"b\":\"c\"}", "{\"a\":null}", "{\"b\":\"c\"}"));
+    CHECK(merged("{\"a\":[\"b\"]}", "{\"a\":\"c\"}", "{\"a\":\"c\"}"));
+    CHECK(merged("{\"a\":\"c\"}", "{\"a\":[\"b\"]}", "{\"a\":[\"b\"]}"));
+    CHECK(merged("{\"a\":{\"b\":\"c\"}}", "{\"a\":{\"b\":\"d\",\"c\":null}}", "{\"a\":{\"b\":\"d\"}}"));
+    CHECK(merged("{\"a\":[{\"b\":\"c\"}]}", "{\"a\":[1]}", "{\"a\":[1]}"));
+    CHECK(merged("{\"e\":null}", "{\"a\":1}", "{\"e\":null,\"a\":1}"));
+    CHECK(merged("{}", "{\"a\":{\"bb\":{\"ccc\":null}}}", "{\"a\":{\"bb\":{}}}"));
+}
+
+static void testFreeze()
+{
+    const QByteArray utf8("{\"s\":\"q\\\"w\",\"l\":[1,2],\"o\":{\"t\":\"\\u0041\"}}");
+    FwJSON::Object root;
+    root.parse(utf8);
+    FwJSON::cast<FwJSON::Array>(root.attribute("l"))->pack();
+    QScopedPointer<FwJSON::Node> copy(root.clone());
+
+    QString value = root.value<FwJSON::String>("s");
+    uint hash = root.hash();
+    root.freeze();
+
+    //Freezing only prepares caches, values stay as they were
+    CHECK(root.isFrozen());
+    CHECK(value == "q\\\"w");
+    CHECK(root.value<FwJSON::String>("s") == value);
+    CHECK(root.hash() == hash);
+    CHECK(root.equals(copy.data()) && copy->equals(&root));
+    CHECK(root.toUtf8() == utf8);
+
+    QScopedPointer<FwJSON::Node> unfrozen(root.clone());
+    CHECK(!unfrozen->isFrozen());
+    CHECK(unfrozen->toUtf8() == utf8);
+
+    //Cached hashes follow nested changes, whatever else the nodes on
+    //the way have cached
+    FwJSON::Object hashed;
+    hashed.parse("{\"a\":{\"b\":{\"c\":1}},\"l\":[1,[2]]}");
+    FwJSON::Object* b = FwJSON::cast<FwJSON::Object>(FwJSON::cast<FwJSON::Object>(hashed.attribute("a"))->attribute("b"));
+    uint before = hashed.hash();
+    b->setValue<FwJSON::Number>("c", 2);
+    FwJSON::Object expected;
+    expected.parse("{\"a\":{\"b\":{\"c\":2}},\"l\":[1,[2]]}");
+    CHECK(hashed.hash() != before && hashed.hash() == expected.hash() && hashed.equals(&expected));
+
+    hashed.setUtf8Cached(true);
+    hashed.toUtf8();
+    b->hash();
+    FwJSON::cast<FwJSON::Array>(FwJSON::cast<FwJSON::Array>(hashed.attribute("l"))->item(1))->addNumber(3);
+    b->setValue<FwJSON::Number>("c", 3);
+    FwJSON::Object changedExpected;
+    changedExpected.parse("{\"a\":{\"b\":{\"c\":3}},\"l\":[1,[2,3]]}");
+    CHECK(hashed.hash() == changedExpected.hash() && hashed.equals(&changedExpected));
+    CHECK(hashed.toUtf8() == changedExpected.toUtf8());
+}
+
+static void testReparse()
+{
+    const QByteArray first("{\"id\":\"a\",\"n\":1,\"l\":[1,2,3],\"o\":{\"x\":\"y\",\"z\":null},\"gone\":true}");
+    const QByteArray second("{\"id\":\"a\",\"n\":2,\"l\":[1,5,3,4],\"o\":{\"x\":\"y\",\"z\":null},\"new\":[\"w\"]}");
+    FwJSON::Object root;
+    root.parse(first, FwJSON::PackNumericArrays);
+    FwJSON::Node* id = root.attribute("id");
+    FwJSON::Node* n = root.attribute("n");
+    FwJSON::Node* list = root.attribute("l");
+    FwJSON::Object* object = FwJSON::cast<FwJSON::Object>(root.attribute("o"));
+    FwJSON::Node* x = object->attribute("x");
+
+    QVector<FwJSON::Node*> changed;
+    root.reparse(second, FwJSON::PackNumericArrays, &changed);
+    FwJSON::Object fresh;
+    fresh.parse(second, FwJSON::PackNumericArrays);
+    CHECK(root.toUtf8() == fresh.toUtf8());
+
+    //Unchanged nodes and containers stay where they were
+    CHECK(root.attribute("id") == id && root.attribute("n") == n && root.attribute("l") == list);
+    CHECK(root.attribute("o") == object && object->attribute("x") == x);
+    CHECK(FwJSON::cast<FwJSON::Array>(list)->isPacked());
+    CHECK(changed.size() == 4);
+    CHECK(changed.contains(n) && changed.contains(list) && changed.contains(&root));
+    CHECK(changed.contains(root.attribute("new")));
+
+    //The same document again changes nothing
+    changed.clear();
+    root.reparse(second, FwJSON::PackNumericArrays, &changed);
+    CHECK(changed.isEmpty());
+
+    //Attributes keep their order, items of other types are replaced
+    const QByteArray third("{\"o\":{\"z\":1,\"x\":\"y\"},\"l\":[1,\"s\"],\"id\":\"b\"}");
+    root.reparse(third, FwJSON::PackNumericArrays);
+    FwJSON::Object reordered;
+    reordered.parse(third, FwJSON::PackNumericArrays);
+    CHECK(root.equals(&reordered));
+    CHECK(root.toUtf8() == "{\"id\":\"b\",\"l\":[1,\"s\"],\"o\":{\"x\":\"y\",\"z\":1}}");
+    CHECK(root.attribute("o") == object && object->attribute("x") == x);
+
+    //Input of the lenient parser is merged, malformed input changes nothing
+    root.reparse("{id:\"c\",l:[1,\"s\",],}");
+    CHECK(root.toUtf8() == "{\"id\":\"c\",\"l\":[1,\"s\"]}");
+    CHECK(root.attribute("id") == id);
+    try
+    {
+        root.reparse("{\"id\":\"d\",\"l\":[2]} x");
+        CHECK(false);
+    }
+    catch(const FwJSON::Exception&)
+    {
+    }
+    //Escapes are checked with and without decoding
+    const FwJSON::ParseOptions escapeOptions[] = { FwJSON::DecodeEscapes, FwJSON::ParseOptions() };
+    for(int i = 0; i < 2; i++)
+    {
+        try
+        {
+            root.reparse("{\"id\":\"\\q\"}", escapeOptions[i]);
+            CHECK(false);
+        }
+        catch(const FwJSON::Exception&)
+        {
+        }
+    }
+    CHECK(root.toUtf8() == "{\"id\":\"c\",\"l\":[1,\"s\"]}");
+}
+
+static void testBinding()
+{
+    Reading reading;
+    reading.id = -7;
+    reading.flags = 4000000000u;
+    reading.stamp = 9007199254740993LL;
+    reading.value = 1. / 3.;
+    reading.valid = true;
+    reading.name = QString::fromUtf8("q\"\n\xc3\xa9");
+    reading.raw = "x\\y";
+    reading.samples << 1 << -2 << 3;
+
+    Reading copy;
+    FwJSON::read(FwJSON::write(reading), &copy);
+    CHECK(copy.id == reading.id && copy.flags == reading.flags && copy.stamp == reading.stamp);
+    CHECK(copy.value == reading.value && copy.valid == reading.valid);
+    CHECK(copy.name == reading.name && copy.raw == reading.raw && copy.samples == reading.samples);
+
+    //Integers are exact and integral, limits of the field type apply
+    FwJSON::read("{\"stamp\":-9223372036854775808,\"id\":1.0,\"flags\":4e9}", &copy);
+    CHECK(copy.stamp == LLONG_MIN && copy.id == 1 && copy.flags == 4000000000u);
+    FwJSON::read("{\"stamp\":9223372036854775807}", &copy);
+    CHECK(copy.stamp == LLONG_MAX);
+    CHECK(readFails("{\"stamp\":9223372036854775808}"));
+    CHECK(readFails("{\"stamp\":123456789012345678901}"));
+    CHECK(readFails("{\"stamp\":1.5}"));
+    CHECK(readFails("{\"id\":2147483648}"));
+    CHECK(readFails("{\"id\":-0.5}"));
+    CHECK(readFails("{\"flags\":-1}"));
+    CHECK(readFails("{\"samples\":[1,2.5]}"));
+
+    //Numbers follow the JSON grammar, forms which only the lenient
+    //parser takes fail and nothing the parser rejects is read
+    const char* const malformed[] = { "01", "-01", ".5", "-.5", "1.", "1.e5" };
+    for(const char* number : malformed)
+    {
+        CHECK(readFails(QByteArray("{\"value\":") + number + "}"));
+        CHECK(readFails(QByteArray("{\"id\":") + number + "}"));
+    }
+    CHECK(parseFails("{\"value\":.5}"));
+
+    //Escapes are decoded without nodes, malformed ones fail
+    FwJSON::read("{\"name\":\"\\u00e9\\n\",\"raw\":\"a\\/b\",\"n\\u0061me\":\"x\"}", &copy);
+    CHECK(copy.name == QString::fromUtf8("x") && copy.raw == "a/b");
+    CHECK(readFails("{\"name\":\"\\q\"}"));
+    CHECK(readFails("{\"raw\":\"\\u12\"}"));
+}
+
+static void testNumbers()
+{
+    //Doubles get the fewest digits which read back as the same value,
+    //nodes and packed arrays are written the same way
+    const double values[] = { 0.1, 1. / 3., 123456789.125, 1e300, -2.5e-300, 9007199254740993. };
+    FwJSON::Object root;
+    FwJSON::Array* packed = root.addArray("packed");
+    FwJSON::Array* nodes = root.addArray("nodes");
+    for(double value : values)
+    {
+        packed->appendNumber(value);
+        nodes->addNumber(value);
+        CHECK(FwJSON::Number(value).toUtf8().toDouble() == value);
+    }
+    QByteArray utf8 = root.toUtf8();
+    CHECK(packed->isPacked() && packed->toUtf8() == nodes->toUtf8());
+    CHECK(FwJSON::Number(0.1).toUtf8() == "0.1");
+    CHECK(FwJSON::Number(1. / 3.).toUtf8() == "0.3333333333333333");
+
+    //Only bound structs take the template, other types the overloads
+    static_assert(FwJSON::IsBound<Reading>::value && !FwJSON::IsBound<float>::value, "IsBound");
+    QByteArray written;
+    FwJSON::Writer writer(&written);
+    writer.write(0.5f);
+    CHECK(written == "0.5");
+
+    FwJSON::Object copy;
+    copy.parse(utf8);
+    CHECK(copy.equals(&root));
+
+    //Infinities and NaN have no JSON form
+    root.addNumber("inf", qInf());
+    nodes->addNumber(qQNaN());
+    CHECK(FwJSON::Number(qInf()).toUtf8() == "null");
+    CHECK(root.toUtf8().endsWith(",null],\"inf\":null}"));
+}
+
+static void testSchema()
+{
+    FwJSON::Object object;
+    object.parse("{\"required\":[\"id\",\"ts\",\"v\"],\"properties\":{\"id\":{\"type\":\"string\"}}}");
+    FwJSON::Schema schema(object);
+
+    //The tree and the text report the same missing property
+    const QByteArray documents[] = { "{\"ts\":1,\"v\":2,\"id\":\"a\"}", "{\"v\":2,\"id\":\"a\",\"x\":0}" };
+    FwJSON::Object root;
+    root.parse(documents[0]);
+    CHECK(schema.isValid(&root) && schema.isValid(documents[0]));
+
+    FwJSON::Object incomplete;
+    incomplete.parse(documents[1]);
+    QByteArray errors[2];
+    try
+    {
+        schema.validate(&incomplete);
+    }
+    catch(const FwJSON::Exception& e)
+    {
+        errors[0] = e.what();
+    }
+    try
+    {
+        schema.validate(documents[1]);
+    }
+    catch(const FwJSON::Exception& e)
+    {
+        errors[1] = e.what();
+    }
+    CHECK(errors[0].contains("Required property \"ts\" is missing"));
+    CHECK(errors[1].contains("Required property \"ts\" is missing"));
+
+    //The tree and the text compare decoded strings
+    FwJSON::Object escaped;
+    escaped.parse("{\"properties\":{\"id\":{\"enum\":[\"a\\\"b\",\"\\u00e9\"],\"maxLength\":3}}}");
+    FwJSON::Schema escapedSchema(escaped);
+    const QByteArray escapedDocuments[] = { "{\"id\":\"a\\\"b\"}", "{\"id\":\"\\u00e9\"}", "{\"id\":\"a\\\\b\"}" };
+    for(int i = 0; i < 3; i++)
+    {
+        FwJSON::Object document;
+        document.parse(escapedDocuments[i]);
+        CHECK(escapedSchema.isValid(&document) == (i < 2));
+        CHECK(escapedSchema.isValid(escapedDocuments[i]) == (i < 2));
+    }
+}
+
+static void testUtf8Cache()
+{
+    //Empty arrays are skipped with their separators
+    FwJSON::Object root;
+    root.parse("{\"a\":[1,[],2,[[]]],\"b\":[[],\"x\",{\"k\":true},[]],\"c\":[[]]}");
+    const QByteArray utf8("{\"a\":[1,2],\"b\":[\"x\",{\"k\":true}]}");
+    CHECK(root.toUtf8() == utf8);
+    root.setUtf8Cached(true);
+    CHECK(root.toUtf8() == utf8);
+    CHECK(root.toUtf8() == utf8);
+
+    //Nested forms come from the cached output, a change serializes its
+    //branch again
+    FwJSON::Array* array = FwJSON::cast<FwJSON::Array>(root.attribute("b"));
+    CHECK(array->toUtf8() == "[\"x\",{\"k\":true}]");
+    FwJSON::cast<FwJSON::Object>(array->item(2))->addBoolean("f", false);
+    FwJSON::cast<FwJSON::Array>(root.attribute("a"))->addArray();
+    FwJSON::cast<FwJSON::Array>(root.attribute("c"))->addNumber(3);
+    const QByteArray changed("{\"a\":[1,2],\"b\":[\"x\",{\"k\":true,\"f\":false}],\"c\":[3]}");
+    QByteArray buffer("[");
+    FwJSON::Writer writer(&buffer);
+    root.write(&writer);
+    CHECK(buffer == "[" + changed);
+    CHECK(root.toUtf8() == changed);
+    CHECK(array->toUtf8() == "[\"x\",{\"k\":true,\"f\":false}]");
+    CHECK(FwJSON::cast<FwJSON::Array>(root.attribute("c"))->toUtf8() == "[3]");
+
+    QScopedPointer<FwJSON::Node> copy(root.clone());
+    CHECK(copy->toUtf8() == changed);
+    root.freeze();
+    CHECK(root.toUtf8() == changed && array->toUtf8() == "[\"x\",{\"k\":true,\"f\":false}]");
+
+    //Nodes made by unpacking and subtrees which stop caching reset the
+    //forms above them
+    FwJSON::Object packed;
+    packed.parse("{\"o\":{\"l\":[1,2],\"r\":[{\"id\":1},{\"id\":2}]}}",
+                 FwJSON::PackNumericArrays | FwJSON::ColumnarArrays);
+    packed.setUtf8Cached(true);
+    CHECK(packed.toUtf8() == "{\"o\":{\"l\":[1,2],\"r\":[{\"id\":1},{\"id\":2}]}}");
+    FwJSON::Object* inner = FwJSON::cast<FwJSON::Object>(packed.attribute("o"));
+    FwJSON::cast<FwJSON::Number>(FwJSON::cast<FwJSON::Array>(inner->attribute("l"))->item(1))->setValue(3);
+    FwJSON::cast<FwJSON::Object>(FwJSON::cast<FwJSON::Array>(inner->attribute("r"))->item(0))->setValue<FwJSON::Number>("id", 5);
+    CHECK(packed.toUtf8() == "{\"o\":{\"l\":[1,3],\"r\":[{\"id\":5},{\"id\":2}]}}");
+    inner->setUtf8Cached(false);
+    FwJSON::cast<FwJSON::Number>(FwJSON::cast<FwJSON::Array>(inner->attribute("l"))->item(0))->setValue(4);
+    CHECK(packed.toUtf8() == "{\"o\":{\"l\":[4,3],\"r\":[{\"id\":5},{\"id\":2}]}}");
+    packed.parse("{\"n\":[1,{\"m\":[2]}]}", FwJSON::PackNumericArrays);
+    CHECK(packed.toUtf8() == "{\"o\":{\"l\":[4,3],\"r\":[{\"id\":5},{\"id\":2}]},\"n\":[1,{\"m\":[2]}]}");
+
+    //The writer keeps empty values in place of the nodes
+    FwJSON::Object values;
+    values.parse("{\"e\":[[],[]],\"m\":[[],1,[]]}");
+    QByteArray streamed;
+    FwJSON::Writer stream(&streamed);
+    stream.beginArray();
+    stream.nodeValue(values.attribute("e"));
+    stream.nodeValue(values.attribute("m"));
+    stream.nodeValue(values.attribute("e"));
+    stream.endArray();
+    CHECK(streamed == "[[],[1],[]]");
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+
+    try
+    {
+        testParse();
+        testClone();
+        testViews();
+        testAggregations();
+        testPatch();
+        testFreeze();
+        testReparse();
+        testBinding();
+        testNumbers();
+        testSchema();
+        testUtf8Cache();
+    }
+    catch(const FwJSON::Exception& e)
+    {
+        qWarning() << "FAIL exception:" << e.what();
+        failures++;
+    }
+
+    if(failures > 0)
+    {
+        qWarning() << failures << "checks failed";
+        return 1;
+    }
+    qDebug() << "All checks passed";
+    return 0;
+}